@@ -1,11 +1,21 @@
-import type { LoadTerrain, Search } from './pathfinder.js';
+import type { CreateMatrixStore, CreatePlanner, DistanceFieldSearch, LoadTerrain, SaveTerrainFile, Search, SearchMany, SearchPacked, SearchParallel, StartSearch } from './pathfinder.js';
 import * as pf from '#iv';
-import { makeLoadTerrain, makeSearch } from './pathfinder.js';
+import { makeCreateMatrixStore, makeCreatePlanner, makeDistanceField, makeLoadTerrain, makeSaveTerrainFile, makeSearch, makeSearchMany, makeSearchPacked, makeSearchParallel, makeStartSearch } from './pathfinder.js';
 
-export type { Goal, RoomCallback, WorldTerrain } from './pathfinder.js';
+export type { DistanceField, Goal, MatrixStore, PackedResult, Planner, Progress, Query, RoomCallback, RoomMatrices, SearchHandle, TileChange, WorldTerrain } from './pathfinder.js';
 export * from '#iv';
 
 /** @internal */
 export let _terrain: unknown;
 export const loadTerrain: LoadTerrain = makeLoadTerrain(pf.loadTerrain, terrain => _terrain = terrain);
-export const search: Search = makeSearch(pf.search);
+export const saveTerrainFile: SaveTerrainFile = makeSaveTerrainFile(pf.saveTerrainFile);
+export const searchMany: SearchMany = makeSearchMany(pf.searchMany);
+export const searchPacked: SearchPacked = makeSearchPacked(pf.searchPacked, pf.maxRooms);
+export const searchParallel: SearchParallel = makeSearchParallel(pf.searchParallel);
+export const distanceField: DistanceFieldSearch = makeDistanceField(pf.distanceField, pf.maxRooms);
+// Matrix stores, planners and resumable searches are only implemented by the nodejs module. The
+// path cache is shared by every sandbox on a thread, so sandboxes don't get it.
+export const search: Search = makeSearch(pf.search, (pf as Partial<typeof pf>).searchCached);
+export const createMatrixStore: CreateMatrixStore = makeCreateMatrixStore(undefined);
+export const createPlanner: CreatePlanner = makeCreatePlanner(undefined);
+export const startSearch: StartSearch = makeStartSearch(undefined);
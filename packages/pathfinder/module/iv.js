@@ -5,11 +5,11 @@ import triplet from './triplet.js';
 
 const require = createRequire(import.meta.url);
 export const path = require.resolve(`@xxscreeps/pathfinder-${triplet}/iv.${triplet}.node`);
-export const { loadTerrain, search, version } = require(path);
+export const { configureParallelSearch, configurePathCache, distanceField, findRoute, loadTerrain, loadTerrainFile, maxRooms, saveTerrainFile, search, searchCached, searchMany, searchPacked, searchParallel, searchStats, stats, version } = require(path);
 export const module = await NativeModule.create(path, {
 	origin: pathToFileURL(path).href,
 	suffix: '',
 });
-if (version !== 12) {
+if (version !== 29) {
 	throw new Error('pf.node is out of date. Please reinstall.');
 }
@@ -8,18 +8,135 @@ interface Goal {
 	pos: number;
 	range: number;
 }
+interface SearchOptions {
+	heuristicWeight: number;
+	plainCost: number;
+	swampCost: number;
+	maxCost: number;
+	maxOps: number;
+	maxRooms: number;
+	maxTime: number;
+	checkInterval: number;
+	bidirectional: boolean;
+	hierarchical: boolean;
+	landmarks: boolean;
+}
+interface Query {
+	origin: number;
+	goals: readonly Goal[];
+	flee: boolean;
+	options: SearchOptions;
+}
+interface RoomMatrix {
+	room: number;
+	matrix: Readonly<Uint8Array> | undefined;
+}
+interface StoredMatrices {
+	store: number;
+	variant: number;
+}
+interface TileChange {
+	pos: number;
+	cost: number;
+}
 interface PathResult {
 	path: number[];
 	ops: number;
 	cost: number;
 	incomplete: boolean;
 }
+interface PackedResult {
+	length: number;
+	ops: number;
+	cost: number;
+	incomplete: boolean;
+}
+interface SearchProgress extends PathResult {
+	done: boolean;
+}
+interface Stats {
+	searches: number;
+	popped: number;
+	stale: number;
+	pushed: number;
+	spills: number;
+	roomsOpened: number;
+	roomsBlocked: number;
+	callbacks: number;
+	callbackTime: number;
+	jumps: number;
+	jumpLength: number;
+	expandTime: number;
+	totalTime: number;
+	opsHistogram: number[];
+	timeHistogram: number[];
+}
 
 export const path: string;
 export const version: number;
+/** Largest `maxRooms` a search accepts */
+export const maxRooms: number;
+
+export function clearCostMatrices(store: number, variant: number | undefined): void;
+
+export function configureParallelSearch(workers: number): void;
+
+export function configurePathCache(maxBytes: number, maxAge: number): void;
+
+export function costMatrixVersion(store: number, variant: number, room: number): number | undefined;
+
+export function createMatrixStore(): number;
+
+export function createPlanner(
+	origin: number,
+	goals: readonly Goal[],
+	plainCost: number,
+	swampCost: number,
+	maxRooms: number,
+): number;
+
+export function distanceField(
+	goals: readonly Goal[],
+	roomCallback: RoomCallback | undefined,
+	plainCost: number,
+	swampCost: number,
+	maxRooms: number,
+	maxOps: number,
+	maxCost: number,
+	distances: Uint16Array,
+	directions: Uint8Array,
+): number[];
+
+export function findRoute(
+	origin: number,
+	destination: number,
+	costs: Readonly<Float64Array> | undefined,
+): number[] | undefined;
+
+export function freeMatrixStore(store: number): void;
+
+export function freePlanner(handle: number): void;
+
+export function freeSearch(handle: number): void;
 
 export function loadTerrain(world: WorldTerrain): void;
 
+export function loadTerrainFile(path: string): boolean;
+
+export function patchCostMatrices(
+	store: number,
+	variant: number,
+	changes: readonly TileChange[],
+): void;
+
+export function resumeSearch(
+	handle: number,
+	roomCallback: RoomCallback | undefined,
+	maxOps: number,
+): SearchProgress;
+
+export function saveTerrainFile(path: string, world: WorldTerrain): boolean;
+
 export function search(
 	origin: number,
 	goals: readonly Goal[],
@@ -31,4 +148,85 @@ export function search(
 	maxCost: number,
 	flee: boolean,
 	heuristicWeight: number,
+	bidirectional: boolean,
+	hierarchical: boolean,
+	landmarks: boolean,
+	maxTime: number,
+	checkInterval: number,
+	matrices: readonly RoomMatrix[] | undefined,
+	stored: StoredMatrices | undefined,
+): PathResult;
+
+export function searchCached(
+	time: number,
+	origin: number,
+	goals: readonly Goal[],
+	roomCallback: RoomCallback | undefined,
+	plainCost: number,
+	swampCost: number,
+	maxRooms: number,
+	maxOps: number,
+	maxCost: number,
+	flee: boolean,
+	heuristicWeight: number,
+	bidirectional: boolean,
+	hierarchical: boolean,
+	landmarks: boolean,
+	maxTime: number,
+	checkInterval: number,
+	matrices: readonly RoomMatrix[] | undefined,
+	stored: StoredMatrices | undefined,
+): PathResult;
+
+export function searchMany(
+	queries: readonly Query[],
+	roomCallback: RoomCallback | undefined,
+): PathResult[];
+
+export function searchPacked(
+	time: number | undefined,
+	origin: number,
+	goals: readonly Goal[],
+	roomCallback: RoomCallback | undefined,
+	plainCost: number,
+	swampCost: number,
+	maxRooms: number,
+	maxOps: number,
+	maxCost: number,
+	flee: boolean,
+	heuristicWeight: number,
+	bidirectional: boolean,
+	hierarchical: boolean,
+	landmarks: boolean,
+	maxTime: number,
+	checkInterval: number,
+	matrices: readonly RoomMatrix[] | undefined,
+	stored: StoredMatrices | undefined,
+	positions: Int32Array,
+	directions: Uint8Array | undefined,
+): PackedResult;
+
+export function searchParallel(
+	queries: readonly Query[],
+	matrices: readonly RoomMatrix[],
+): PathResult[];
+
+export function searchStats(): Stats;
+
+export function setCostMatrices(
+	store: number,
+	variant: number,
+	matrices: readonly RoomMatrix[],
+): void;
+
+export function stats(): Stats;
+
+export function startSearch(query: Query): number;
+
+export function updatePlanner(
+	handle: number,
+	origin: number,
+	changes: readonly TileChange[],
+	roomCallback: RoomCallback | undefined,
+	maxOps: number,
 ): PathResult;
@@ -3,7 +3,7 @@ import triplet from './triplet.js';
 
 const require = createRequire(import.meta.url);
 export const path = require.resolve(`@xxscreeps/pathfinder-${triplet}/pf.${triplet}.node`);
-export const { loadTerrain, search, version } = require(path);
-if (version !== 12) {
+export const { clearCostMatrices, configureParallelSearch, configurePathCache, costMatrixVersion, createMatrixStore, createPlanner, distanceField, findRoute, freeMatrixStore, freePlanner, freeSearch, loadTerrain, loadTerrainFile, maxRooms, patchCostMatrices, resumeSearch, saveTerrainFile, search, searchCached, searchMany, searchPacked, searchParallel, searchStats, setCostMatrices, startSearch, stats, updatePlanner, version } = require(path);
+if (version !== 29) {
 	throw new Error('pf.node is out of date. Please reinstall.');
 }
@@ -1,11 +1,45 @@
 import type * as pf from '#pf';
 
 export interface Options {
+	bidirectional?: boolean | undefined;
+	/**
+	 * Number of ops between checks of `maxTime` and of script termination. Lower values stop closer to
+	 * the deadline at some cost to search speed.
+	 */
+	checkInterval?: number | undefined;
+	/**
+	 * Current game tick. When set, repeated searches are answered from a native cache until a room
+	 * callback result changes or the entry goes unused for too many ticks. Ignored in sandboxes, which
+	 * would otherwise share one cache per thread.
+	 */
+	cacheTime?: number | undefined;
 	flee?: boolean | undefined;
 	heuristicWeight?: number | undefined;
+	hierarchical?: boolean | undefined;
+	/**
+	 * Tighten the heuristic of single-goal searches with landmark distances precomputed from terrain.
+	 * Results may be suboptimal if a room callback makes a terrain wall walkable.
+	 */
+	landmarks?: boolean | undefined;
+	/**
+	 * Cost matrices known ahead of time. These are used instead of invoking `roomCallback`, which is
+	 * then only invoked for rooms missing from this list.
+	 */
+	matrices?: RoomMatrices | undefined;
+	/**
+	 * Matrices of `matrixVariant` in this store are used after `matrices` and before invoking
+	 * `roomCallback`.
+	 */
+	matrixStore?: MatrixStore | undefined;
+	matrixVariant?: string | undefined;
 	maxCost?: number | undefined;
 	maxOps?: number | undefined;
 	maxRooms?: number | undefined;
+	/**
+	 * Wall-clock budget of the search in microseconds. The search stops as if it ran out of ops once
+	 * this passes.
+	 */
+	maxTime?: number | undefined;
 	plainCost?: number | undefined;
 	swampCost?: number | undefined;
 }
@@ -61,6 +95,15 @@ export interface Result<Position> {
 	incomplete: boolean;
 }
 
+/**
+ * Distances and directions toward the nearest goal for every tile of a room, indexed by
+ * `y * 50 + x`. Tiles which were not reached have a distance of `0xffff` and a direction of `0`.
+ */
+export interface DistanceField {
+	distances: Uint16Array;
+	directions: Uint8Array;
+}
+
 export type LoadTerrain = (world: WorldTerrain) => void;
 
 export const makeLoadTerrain = (
@@ -75,6 +118,16 @@ export const makeLoadTerrain = (
 		loadTerrain(terrain);
 	};
 
+export type SaveTerrainFile = (path: string, world: WorldTerrain) => boolean;
+
+/**
+ * Writes terrain to a file for `loadTerrainFile`, which maps it read-only so that every process on a
+ * host shares one copy. Unlike `loadTerrain`, mapped terrain doesn't need to be kept alive from
+ * JavaScript. Returns false if the file couldn't be written.
+ */
+export const makeSaveTerrainFile = (saveTerrainFile: typeof pf.saveTerrainFile): SaveTerrainFile =>
+	(path, world) => saveTerrainFile(path, [ ...world.map(([ room, terrain ]) => ({ room, terrain })) ]);
+
 /**
  * `position` format is little-endian backed "world position" type:
  *
@@ -94,7 +147,31 @@ export type Search = <Position>(
 	options: Options,
 ) => Result<Position>;
 
-export const makeSearch = (search: typeof pf.search): Search =>
+// Extract and cast options
+const castOptions = (options: Options) => ({
+	plainCost: Number(options.plainCost ?? 1) | 0,
+	swampCost: Number(options.swampCost ?? 5) | 0,
+	heuristicWeight: Number(options.heuristicWeight) || 1.2,
+	maxOps: Number(options.maxOps ?? 0x7fffffff) | 0,
+	maxCost: Number(options.maxCost ?? 0x7fffffff) | 0,
+	maxRooms: Number(options.maxRooms ?? 16) | 0,
+	maxTime: Number(options.maxTime ?? 0) | 0,
+	checkInterval: Number(options.checkInterval ?? 0) | 0,
+	bidirectional: Boolean(options.bidirectional),
+	hierarchical: Boolean(options.hierarchical),
+	landmarks: Boolean(options.landmarks),
+});
+
+// Cast preloaded matrices for native code
+const castMatrices = (matrices: RoomMatrices | undefined) =>
+	matrices === undefined
+		? undefined
+		: Array.from(matrices, ([ room, matrix ]) => ({ room, matrix: matrix || undefined }));
+
+// Store and variant number for native code
+const castStored = (options: Options) => options.matrixStore?.stored(options.matrixVariant ?? '');
+
+export const makeSearch = (search: typeof pf.search, searchCached: typeof pf.searchCached | undefined): Search =>
 	(origin, goals, roomCallback, makePosition, options) => {
 
 		// Short circuit if there are no goals
@@ -103,29 +180,412 @@ export const makeSearch = (search: typeof pf.search): Search =>
 		}
 
 		// Extract and cast options
-		const plainCost = Number(options.plainCost ?? 1) | 0;
-		const swampCost = Number(options.swampCost ?? 5) | 0;
-		const heuristicWeight = Number(options.heuristicWeight) || 1.2;
-		const maxOps = Number(options.maxOps ?? 0x7fffffff) | 0;
-		const maxCost = Number(options.maxCost ?? 0x7fffffff) | 0;
-		const maxRooms = Number(options.maxRooms ?? 16) | 0;
+		const { plainCost, swampCost, heuristicWeight, maxOps, maxCost, maxRooms, maxTime, checkInterval, bidirectional, hierarchical, landmarks } = castOptions(options);
+		const flee = Boolean(options.flee);
+		const matrices = castMatrices(options.matrices);
+		const stored = castStored(options);
+
+		// Invoke native code
+		const { cacheTime } = options;
+		const ret = cacheTime === undefined || searchCached === undefined
+			? search(
+				origin, goals,
+				roomCallback,
+				plainCost, swampCost,
+				maxRooms, maxOps, maxCost,
+				flee,
+				heuristicWeight,
+				bidirectional,
+				hierarchical,
+				landmarks,
+				maxTime, checkInterval,
+				matrices,
+				stored,
+			)
+			: searchCached(
+				Number(cacheTime) | 0,
+				origin, goals,
+				roomCallback,
+				plainCost, swampCost,
+				maxRooms, maxOps, maxCost,
+				flee,
+				heuristicWeight,
+				bidirectional,
+				hierarchical,
+				landmarks,
+				maxTime, checkInterval,
+				matrices,
+				stored,
+			);
+
+		// Translate results
+		return {
+			...ret,
+			path: makeCompletePath(makePosition, ret.path),
+		};
+	};
+
+export interface Query {
+	origin: number;
+	goals: readonly Goal[];
+	options: Options;
+}
+
+/**
+ * Result of `searchPacked`. `path` holds every tile after the origin as a packed world position, and
+ * `directions` holds the direction constant of each step when requested.
+ */
+export interface PackedResult {
+	path: Int32Array;
+	directions: Uint8Array | undefined;
+	ops: number;
+	cost: number;
+	incomplete: boolean;
+}
+
+/**
+ * Same as `Search`, but the path is expanded natively into typed arrays instead of one position
+ * object per tile.
+ */
+export type SearchPacked = (
+	origin: number,
+	goals: readonly Goal[],
+	roomCallback: RoomCallback | undefined,
+	options: Options & { directions?: boolean | undefined },
+) => PackedResult;
+
+// Scratch buffers for `searchPacked`, which are grown to fit the largest search so far. A path
+// never visits a tile twice, so `maxRooms` rooms of tiles is always enough.
+let packedPositions = new Int32Array(0);
+let packedDirections = new Uint8Array(0);
+
+export const makeSearchPacked = (searchPacked: typeof pf.searchPacked, roomCapacity: number): SearchPacked =>
+	(origin, goals, roomCallback, options) => {
+
+		// Short circuit if there are no goals
+		const withDirections = Boolean(options.directions);
+		if (goals.length === 0) {
+			return { path: new Int32Array(0), directions: withDirections ? new Uint8Array(0) : undefined, ops: 0, cost: 0, incomplete: false };
+		}
+
+		// Extract and cast options
+		const { plainCost, swampCost, heuristicWeight, maxOps, maxCost, maxRooms, maxTime, checkInterval, bidirectional, hierarchical, landmarks } = castOptions(options);
 		const flee = Boolean(options.flee);
+		const capacity = Math.max(1, Math.min(maxRooms, roomCapacity)) * 2500;
+		if (packedPositions.length < capacity) {
+			packedPositions = new Int32Array(capacity);
+		}
+		if (withDirections && packedDirections.length < capacity) {
+			packedDirections = new Uint8Array(capacity);
+		}
+		// A room callback may run a larger `searchPacked`, which replaces the scratch buffers
+		const positions = packedPositions;
+		const directions = withDirections ? packedDirections : undefined;
 
 		// Invoke native code
-		const ret = search(
+		const { cacheTime } = options;
+		const { length, ...ret } = searchPacked(
+			cacheTime === undefined ? undefined : Number(cacheTime) | 0,
 			origin, goals,
 			roomCallback,
 			plainCost, swampCost,
 			maxRooms, maxOps, maxCost,
 			flee,
 			heuristicWeight,
+			bidirectional,
+			hierarchical,
+			landmarks,
+			maxTime, checkInterval,
+			castMatrices(options.matrices),
+			castStored(options),
+			positions,
+			directions,
 		);
 
-		// Translate results
+		// Copy out of the scratch buffers, which the next search reuses
 		return {
+			...ret,
+			path: positions.slice(0, length),
+			directions: directions?.slice(0, length),
+		};
+	};
+
+/**
+ * Runs each query with one shared `roomCallback`, which is invoked at most once per room for the
+ * whole batch.
+ */
+export type SearchMany = <Position>(
+	queries: readonly Query[],
+	roomCallback: RoomCallback | undefined,
+	makePosition: MakePosition<Position>,
+) => Result<Position>[];
+
+// Cast each query for native code
+const castQueries = (queries: readonly Query[]) =>
+	queries.map(({ origin, goals, options }) => ({
+		origin,
+		goals,
+		flee: Boolean(options.flee),
+		options: castOptions(options),
+	}));
+
+export const makeSearchMany = (searchMany: typeof pf.searchMany): SearchMany =>
+	(queries, roomCallback, makePosition) => {
+		const results = searchMany(castQueries(queries), roomCallback);
+		return results.map(ret => ({
 			...ret,
 			path: makeCompletePath(makePosition, ret.path),
+		}));
+	};
+
+/**
+ * Cost matrix for each room a parallel batch may enter. `false` blocks the room and unlisted rooms
+ * use plain terrain.
+ */
+export type RoomMatrices = Iterable<readonly [ number, Uint8Array | false ]>;
+
+/**
+ * Runs each query on a pool of native threads and blocks until all are done. Room callbacks can't
+ * run on other threads, so matrices are passed upfront. Only available in nodejs.
+ */
+export type SearchParallel = <Position>(
+	queries: readonly Query[],
+	matrices: RoomMatrices,
+	makePosition: MakePosition<Position>,
+) => Result<Position>[];
+
+export const makeSearchParallel = (searchParallel: typeof pf.searchParallel | undefined): SearchParallel =>
+	(queries, matrices, makePosition) => {
+		if (searchParallel === undefined) {
+			throw new Error('`searchParallel` is not available in this context');
+		}
+		const results = searchParallel(
+			castQueries(queries),
+			Array.from(matrices, ([ room, matrix ]) => ({ room, matrix: matrix || undefined })),
+		);
+		return results.map(ret => ({
+			...ret,
+			path: makeCompletePath(makePosition, ret.path),
+		}));
+	};
+
+/**
+ * Result of `SearchHandle.resume`. When `done` is false the search ran out of ops and may be
+ * resumed, and `path` leads to the closest node found so far.
+ */
+export interface Progress<Position> extends Result<Position> {
+	done: boolean;
+}
+
+/**
+ * Search which keeps its state between calls so that it can be spread over several ticks. Each
+ * `resume` expands up to `maxOps` more nodes. Rooms are resolved by `roomCallback` the first time
+ * the search reaches them and the result is kept for the rest of the search.
+ */
+export interface SearchHandle {
+	resume: <Position>(
+		roomCallback: RoomCallback | undefined,
+		makePosition: MakePosition<Position>,
+		maxOps: number,
+	) => Progress<Position>;
+	free: () => void;
+}
+
+export type StartSearch = (query: Query) => SearchHandle;
+
+interface SearchHandleFunctions {
+	freeSearch: typeof pf.freeSearch;
+	resumeSearch: typeof pf.resumeSearch;
+	startSearch: typeof pf.startSearch;
+}
+
+export const makeStartSearch = (functions: SearchHandleFunctions | undefined): StartSearch => {
+	// Searches which are collected without being freed are freed here
+	const registry = functions && new FinalizationRegistry<number>(handle => functions.freeSearch(handle));
+	return query => {
+		if (functions === undefined || registry === undefined) {
+			throw new Error('`startSearch` is not available in this context');
+		}
+		const { freeSearch, resumeSearch, startSearch } = functions;
+		const [ castQuery ] = castQueries([ query ]);
+		const handle = startSearch(castQuery!);
+		const search: SearchHandle = {
+			resume: (roomCallback, makePosition, maxOps) => {
+				const ret = resumeSearch(handle, roomCallback, Number(maxOps) | 0);
+				return {
+					...ret,
+					path: makeCompletePath(makePosition, ret.path),
+				};
+			},
+			free: () => {
+				registry.unregister(search);
+				freeSearch(handle);
+			},
 		};
+		registry.register(search, handle, search);
+		return search;
+	};
+};
+
+/**
+ * New cost of one tile for `Planner.update` or `MatrixStore.patch`, using `CostMatrix` values. 0
+ * restores the terrain cost and 255 is an obstacle.
+ */
+export interface TileChange {
+	pos: number;
+	cost: number;
+}
+
+/**
+ * Incremental planner which keeps its search state between updates. Each update applies changed
+ * tiles and a new origin, then repairs the previous path instead of searching again. Rooms are
+ * resolved by `roomCallback` the first time the planner reaches them, and later changes in those
+ * rooms must be passed as `changes`.
+ */
+export interface Planner {
+	update: <Position>(
+		origin: number,
+		changes: readonly TileChange[],
+		roomCallback: RoomCallback | undefined,
+		makePosition: MakePosition<Position>,
+		maxOps?: number,
+	) => Result<Position>;
+	free: () => void;
+}
+
+export type CreatePlanner = (origin: number, goals: readonly Goal[], options: Options) => Planner;
+
+interface PlannerFunctions {
+	createPlanner: typeof pf.createPlanner;
+	freePlanner: typeof pf.freePlanner;
+	updatePlanner: typeof pf.updatePlanner;
+}
+
+export const makeCreatePlanner = (functions: PlannerFunctions | undefined): CreatePlanner => {
+	// Planners which are collected without being freed are freed here
+	const registry = functions && new FinalizationRegistry<number>(handle => functions.freePlanner(handle));
+	return (origin, goals, options) => {
+		if (functions === undefined || registry === undefined) {
+			throw new Error('`createPlanner` is not available in this context');
+		}
+		const { createPlanner, freePlanner, updatePlanner } = functions;
+		const { plainCost, swampCost, maxRooms } = castOptions(options);
+		const handle = createPlanner(origin, goals, plainCost, swampCost, maxRooms);
+		const planner: Planner = {
+			update: (origin, changes, roomCallback, makePosition, maxOps = 0x7fffffff) => {
+				const ret = updatePlanner(handle, origin, changes, roomCallback, Number(maxOps) | 0);
+				return {
+					...ret,
+					path: makeCompletePath(makePosition, ret.path),
+				};
+			},
+			free: () => {
+				registry.unregister(planner);
+				freePlanner(handle);
+			},
+		};
+		registry.register(planner, handle, planner);
+		return planner;
+	};
+};
+
+/**
+ * Cost matrices which are kept natively between searches and ticks, so that they don't need to be
+ * passed to each search. Matrices are grouped by `variant`, for example one per set of matrix
+ * options, and each search reads the variant named by its options. Every change to a room's matrix
+ * gives it a new version, and native search caches are keyed on that version.
+ */
+export interface MatrixStore {
+	/** Replaces the matrices of the listed rooms. `false` blocks the room. */
+	set: (variant: string, matrices: RoomMatrices) => void;
+	/** Changes single tiles. Rooms without a matrix start from terrain costs. */
+	patch: (variant: string, changes: readonly TileChange[]) => void;
+	/** Removes the matrices of `variant`, or of every variant if none is given */
+	clear: (variant?: string) => void;
+	/** Version of a room's matrix, or `undefined` if it has none */
+	version: (variant: string, room: number) => number | undefined;
+	free: () => void;
+	/** @internal */
+	stored: (variant: string) => { store: number; variant: number };
+}
+
+export type CreateMatrixStore = () => MatrixStore;
+
+interface MatrixStoreFunctions {
+	clearCostMatrices: typeof pf.clearCostMatrices;
+	costMatrixVersion: typeof pf.costMatrixVersion;
+	createMatrixStore: typeof pf.createMatrixStore;
+	freeMatrixStore: typeof pf.freeMatrixStore;
+	patchCostMatrices: typeof pf.patchCostMatrices;
+	setCostMatrices: typeof pf.setCostMatrices;
+}
+
+export const makeCreateMatrixStore = (functions: MatrixStoreFunctions | undefined): CreateMatrixStore => {
+	// Stores which are collected without being freed are freed here
+	const registry = functions && new FinalizationRegistry<number>(handle => functions.freeMatrixStore(handle));
+	return () => {
+		if (functions === undefined || registry === undefined) {
+			throw new Error('`createMatrixStore` is not available in this context');
+		}
+		const { clearCostMatrices, costMatrixVersion, createMatrixStore, freeMatrixStore, patchCostMatrices, setCostMatrices } = functions;
+		const handle = createMatrixStore();
+		// Native code numbers variants, which are assigned on first use
+		const variants = new Map<string, number>();
+		const variantOf = (name: string) => {
+			let variant = variants.get(name);
+			if (variant === undefined) {
+				variant = variants.size;
+				variants.set(name, variant);
+			}
+			return variant;
+		};
+		const store: MatrixStore = {
+			set: (variant, matrices) => setCostMatrices(
+				handle,
+				variantOf(variant),
+				Array.from(matrices, ([ room, matrix ]) => ({ room, matrix: matrix || undefined })),
+			),
+			patch: (variant, changes) => patchCostMatrices(handle, variantOf(variant), changes),
+			clear: variant => clearCostMatrices(handle, variant === undefined ? undefined : variantOf(variant)),
+			version: (variant, room) => costMatrixVersion(handle, variantOf(variant), room),
+			free: () => {
+				registry.unregister(store);
+				freeMatrixStore(handle);
+			},
+			stored: variant => ({ store: handle, variant: variantOf(variant) }),
+		};
+		registry.register(store, handle, store);
+		return store;
+	};
+};
+
+export type DistanceFieldSearch = (
+	goals: readonly Goal[],
+	roomCallback: RoomCallback | undefined,
+	options: Options,
+) => Map<number, DistanceField>;
+
+export const makeDistanceField = (distanceField: typeof pf.distanceField, roomCapacity: number): DistanceFieldSearch =>
+	(goals, roomCallback, options) => {
+
+		// Extract and cast options
+		const { plainCost, swampCost, maxOps, maxCost, ...rest } = castOptions(options);
+		const maxRooms = Math.max(1, Math.min(rest.maxRooms, roomCapacity));
+
+		// Native code fills one 2500 tile slice per opened room
+		const distances = new Uint16Array(maxRooms * 2500);
+		const directions = new Uint8Array(maxRooms * 2500);
+		const rooms = distanceField(
+			goals,
+			roomCallback,
+			plainCost, swampCost,
+			maxRooms, maxOps, maxCost,
+			distances, directions,
+		);
+		return new Map(rooms.map((roomId, ii) => [ roomId, {
+			distances: distances.subarray(ii * 2500, (ii + 1) * 2500),
+			directions: directions.subarray(ii * 2500, (ii + 1) * 2500),
+		} ]));
 	};
 
 function makeCompletePath<Type>(make: MakePosition<Type>, path: readonly number[]): Type[] {
@@ -1,11 +1,24 @@
-import type { LoadTerrain, Search } from './pathfinder.js';
+import type { CreateMatrixStore, CreatePlanner, DistanceFieldSearch, LoadTerrain, SaveTerrainFile, Search, SearchMany, SearchPacked, SearchParallel, StartSearch } from './pathfinder.js';
 import * as pf from '#pf';
-import { makeLoadTerrain, makeSearch } from './pathfinder.js';
+import { makeCreateMatrixStore, makeCreatePlanner, makeDistanceField, makeLoadTerrain, makeSaveTerrainFile, makeSearch, makeSearchMany, makeSearchPacked, makeSearchParallel, makeStartSearch } from './pathfinder.js';
 
-export type { Goal, Result, RoomCallback, WorldTerrain } from './pathfinder.js';
+export type { DistanceField, Goal, MatrixStore, PackedResult, Planner, Progress, Query, Result, RoomCallback, RoomMatrices, SearchHandle, TileChange, WorldTerrain } from './pathfinder.js';
 export * from '#pf';
 
 /** @internal */
 export let _terrain: unknown;
 export const loadTerrain: LoadTerrain = makeLoadTerrain(pf.loadTerrain, terrain => _terrain = terrain);
-export const search: Search = makeSearch(pf.search);
+export const saveTerrainFile: SaveTerrainFile = makeSaveTerrainFile(pf.saveTerrainFile);
+export const searchMany: SearchMany = makeSearchMany(pf.searchMany);
+export const searchPacked: SearchPacked = makeSearchPacked(pf.searchPacked, pf.maxRooms);
+export const searchParallel: SearchParallel = makeSearchParallel(pf.searchParallel);
+export const distanceField: DistanceFieldSearch = makeDistanceField(pf.distanceField, pf.maxRooms);
+// Matrix stores, planners and resumable searches are kept by handle, so they are only offered to
+// nodejs and not to `isolated-vm` sandboxes, which load this module with `InitForContext`. The path
+// cache is shared by every sandbox on a thread, so it's left out of sandboxes too.
+// eslint-disable-next-line @typescript-eslint/no-unnecessary-condition
+const handles = pf.createPlanner === undefined ? undefined : pf;
+export const search: Search = makeSearch(pf.search, handles?.searchCached);
+export const createMatrixStore: CreateMatrixStore = makeCreateMatrixStore(handles);
+export const createPlanner: CreatePlanner = makeCreatePlanner(handles);
+export const startSearch: StartSearch = makeStartSearch(handles);
@@ -9,36 +9,8 @@ auto astar = []<astar_pathfinder Type>(Type pf, const indexed_position_t pos, co
 	assert(pos_index_t{pos} == index);
 	for (auto dir : contiguous_enum_range(direction_t::TOP, direction_t::TOP_LEFT)) {
 		auto neighbor = pos.position_in_direction(dir);
-
-		// If this is a portal node there are some moves which will be impossible, and should be discarded
-		if (pos.xx % 50 == 0) {
-			if (
-				(neighbor.xx % 50 == 49 && pos.yy != neighbor.yy) ||
-				pos.xx == neighbor.xx
-			) {
-				continue;
-			}
-		} else if (pos.xx % 50 == 49) {
-			if (
-				(neighbor.xx % 50 == 0 && pos.yy != neighbor.yy) ||
-				pos.xx == neighbor.xx
-			) {
-				continue;
-			}
-		} else if (pos.yy % 50 == 0) {
-			if (
-				(neighbor.yy % 50 == 49 && pos.xx != neighbor.xx) ||
-				pos.yy == neighbor.yy
-			) {
-				continue;
-			}
-		} else if (pos.yy % 50 == 49) {
-			if (
-				(neighbor.yy % 50 == 0 && pos.xx != neighbor.xx) ||
-				pos.yy == neighbor.yy
-			) {
-				continue;
-			}
+		if (!is_possible_move(pos, neighbor)) {
+			continue;
 		}
 
 		// Calculate cost of this move
@@ -51,4 +23,23 @@ auto astar = []<astar_pathfinder Type>(Type pf, const indexed_position_t pos, co
 	}
 };
 
+// Run an iteration of A* over reversed edges, used by the goal frontier of a bidirectional search.
+// Moves are symmetric but the cost is paid when entering a tile, so stepping backward from `pos`
+// onto `neighbor` costs whatever `pos` costs.
+auto reverse_astar = []<jps_pathfinder Type>(Type pf, const indexed_position_t pos, const pos_index_t index, cost_t g_cost) -> void {
+	assert(pos_index_t{pos} == index);
+	cost_t cost = pf.look(pos);
+	for (auto dir : contiguous_enum_range(direction_t::TOP, direction_t::TOP_LEFT)) {
+		auto neighbor = pos.position_in_direction(dir);
+		if (!is_possible_move(pos, neighbor)) {
+			continue;
+		}
+		auto [ room_index, n_cost ] = pf.look_open(neighbor);
+		if (n_cost == obstacle) {
+			continue;
+		}
+		pf.push_node({room_index, neighbor}, index, g_cost + cost);
+	}
+};
+
 } // namespace screeps
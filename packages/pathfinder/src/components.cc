@@ -0,0 +1,178 @@
+export module screeps:components;
+import :landmarks;
+import :position;
+import :room;
+import :utility;
+import std;
+
+namespace screeps {
+
+// Goals with a larger range than this are never rejected, since every tile in range is checked
+export constexpr auto k_max_component_range = 24;
+
+// Connected components of walkable terrain over the whole world. Each room is labeled on its own,
+// and then labels which meet at a room exit are joined, so a component may span many rooms. A goal
+// in another component than the origin can't be reached by any path which only crosses walkable
+// terrain.
+class component_table {
+	public:
+		explicit component_table(const landmark_rooms_type& rooms) :
+				labels_(rooms.size() * 2500) {
+			std::ranges::fill(slots_, 0);
+			for (const auto& [ ii, entry ] : std::views::enumerate(rooms)) {
+				slots_[ std::bit_cast<std::uint16_t>(entry.first) ] = static_cast<std::uint16_t>(ii + 1);
+			}
+
+			// Label each room. Index 0 of `parents_` stands for walls.
+			parents_.push_back(0);
+			offsets_.reserve(rooms.size());
+			for (const auto& [ ii, entry ] : std::views::enumerate(rooms)) {
+				offsets_.push_back(static_cast<std::uint32_t>(parents_.size() - 1));
+				label_room(static_cast<std::size_t>(ii), entry.first, entry.second);
+			}
+
+			// Join labels across room exits. Exit tiles only lead to the tile directly across the
+			// border, which `is_possible_move` checks.
+			for (const auto& [ ii, entry ] : std::views::enumerate(rooms)) {
+				auto origin = world_position_t{entry.first.xx * 50, entry.first.yy * 50};
+				for (int edge = 0; edge < 50; ++edge) {
+					for (auto local : {std::pair{edge, 0}, std::pair{49, edge}, std::pair{edge, 49}, std::pair{0, edge}}) {
+						auto pos = world_position_t{origin.xx + local.first, origin.yy + local.second};
+						auto from = find(pos);
+						if (from == 0) {
+							continue;
+						}
+						for (auto dir : contiguous_enum_range(direction_t::TOP, direction_t::TOP_LEFT)) {
+							auto neighbor = pos.position_in_direction(dir);
+							if (neighbor.room() != entry.first && is_possible_move(pos, neighbor)) {
+								if (auto to = find(neighbor); to != 0) {
+									unite(from, to);
+								}
+							}
+						}
+					}
+				}
+			}
+
+			// Flatten, so that lookups don't need to follow parents
+			for (std::uint32_t label = 0; label < parents_.size(); ++label) {
+				parents_[ label ] = root(label);
+			}
+		}
+
+		// Returns the component of `pos`, or 0 for walls and rooms which aren't loaded
+		[[nodiscard]] auto operator()(world_position_t pos) const -> std::uint32_t {
+			return parents_[ label_of(pos) ];
+		}
+
+	private:
+		// Flood fills the walkable tiles of one room
+		auto label_room(std::size_t index, room_location_t room, terrain_type terrain) -> void {
+			auto look = room_terrain{terrain, nullptr};
+			auto unit_costs = terrain_cost_type{{1, obstacle, 1, obstacle}};
+			auto labels = std::span{labels_}.subspan(index * 2500, 2500);
+			auto origin = world_position_t{room.xx * 50, room.yy * 50};
+			auto queue = std::vector<world_position_t>{};
+			for (int tile = 0; tile < 2500; ++tile) {
+				if (labels[ tile ] != 0 || look(unit_costs, tile % 50, tile / 50) == obstacle) {
+					continue;
+				}
+				auto label = static_cast<std::uint32_t>(parents_.size() - offsets_.back());
+				parents_.push_back(static_cast<std::uint32_t>(parents_.size()));
+				labels[ tile ] = static_cast<std::uint16_t>(label);
+				queue.assign({world_position_t{origin.xx + (tile % 50), origin.yy + (tile / 50)}});
+				for (std::size_t head = 0; head < queue.size(); ++head) {
+					auto pos = queue[ head ];
+					for (auto dir : contiguous_enum_range(direction_t::TOP, direction_t::TOP_LEFT)) {
+						auto neighbor = pos.position_in_direction(dir);
+						if (neighbor.room() != room || !is_possible_move(pos, neighbor)) {
+							continue;
+						}
+						auto local = ((neighbor.yy - origin.yy) * 50) + (neighbor.xx - origin.xx);
+						if (labels[ local ] == 0 && look(unit_costs, local % 50, local / 50) != obstacle) {
+							labels[ local ] = static_cast<std::uint16_t>(label);
+							queue.push_back(neighbor);
+						}
+					}
+				}
+			}
+		}
+
+		[[nodiscard]] auto label_of(world_position_t pos) const -> std::uint32_t {
+			if (pos.xx < 0 || pos.yy < 0 || pos.xx >= 256 * 50 || pos.yy >= 256 * 50) {
+				return 0;
+			}
+			auto slot = slots_[ std::bit_cast<std::uint16_t>(pos.room()) ];
+			if (slot == 0) {
+				return 0;
+			}
+			auto label = labels_[ ((slot - 1) * std::size_t{2500}) + (pos.yy % 50 * 50) + (pos.xx % 50) ];
+			return label == 0 ? 0 : offsets_[ slot - 1 ] + label;
+		}
+
+		// Union-find over labels. `find` is only used while building, before parents are flattened.
+		[[nodiscard]] auto find(world_position_t pos) -> std::uint32_t {
+			auto label = label_of(pos);
+			return label == 0 ? 0 : root(label);
+		}
+
+		[[nodiscard]] auto root(std::uint32_t label) -> std::uint32_t {
+			while (parents_[ label ] != label) {
+				parents_[ label ] = parents_[ parents_[ label ] ];
+				label = parents_[ label ];
+			}
+			return label;
+		}
+
+		auto unite(std::uint32_t left, std::uint32_t right) -> void {
+			auto [ low, high ] = std::minmax(root(left), root(right));
+			parents_[ high ] = low;
+		}
+
+		std::array<std::uint16_t, 1 << 16> slots_{};
+		std::vector<std::uint32_t> offsets_;
+		std::vector<std::uint16_t> labels_;
+		std::vector<std::uint32_t> parents_;
+};
+
+// Rooms of the next table, if terrain changed since the last one was built, and the most recently
+// built table
+std::mutex component_lock;
+std::optional<landmark_rooms_type> component_rooms;
+std::shared_ptr<const component_table> component_snapshot;
+
+// Replaces the rooms which terrain components span. The table is rebuilt by the next search which
+// needs it, which is quick enough to do on the searching thread, unlike landmarks.
+export auto reset_components(landmark_rooms_type rooms) -> void {
+	std::lock_guard lock{component_lock};
+	component_rooms = std::move(rooms);
+}
+
+// Returns the current table, or `nullptr` if no terrain has been loaded
+export auto components() -> std::shared_ptr<const component_table> {
+	std::lock_guard lock{component_lock};
+	if (component_rooms) {
+		component_snapshot = std::make_shared<const component_table>(*component_rooms);
+		component_rooms.reset();
+	}
+	return component_snapshot;
+}
+
+// Returns true if some walkable tile within range of `goal` is in the component of `origin`. Goals
+// are kept if `origin` is not on walkable terrain, or if the range is too large to check.
+export auto is_reachable(const component_table& table, world_position_t origin, world_position_t goal, int range) -> bool {
+	auto component = table(origin);
+	if (component == 0 || range > k_max_component_range) {
+		return true;
+	}
+	for (int dy = -range; dy <= range; ++dy) {
+		for (int dx = -range; dx <= range; ++dx) {
+			if (table({goal.xx + dx, goal.yy + dy}) == component) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+} // namespace screeps
@@ -6,6 +6,18 @@ import std;
 
 namespace screeps {
 
+// Count of nodes pushed past the inline capacity of a heap on this thread. Process-wide totals are
+// kept by `record_search`.
+thread_local std::uint64_t heap_spill_count;
+
+export auto heap_spills() -> std::uint64_t {
+	return heap_spill_count;
+}
+
+auto record_heap_spill() -> void {
+	++heap_spill_count;
+}
+
 constexpr auto sift_up(auto& container, std::size_t pos, auto compare, auto projection) -> void {
 	auto val = std::move(container[ pos ]);
 	while (pos != 0) {
@@ -57,7 +69,8 @@ constexpr auto push_heap(auto& container, auto compare, auto projection) -> void
 	sift_up(container, container.size() - 1, compare, projection);
 }
 
-// Priority queue implementation using lazy deletion for score updates
+// Priority queue implementation using lazy deletion for score updates. Nodes past `Capacity` spill
+// into a growable arena instead of failing the search.
 template <class Type, class Compare, class Projection, std::size_t Capacity>
 class heap_t : private Compare, private Projection {
 	public:
@@ -82,12 +95,14 @@ class heap_t : private Compare, private Projection {
 		}
 
 		constexpr auto push(value_type value) -> void {
-			heap_.emplace_back(value);
+			if (heap_.emplace_back(value)) {
+				record_heap_spill();
+			}
 			push_heap(heap_, std::cref(key_comp()), std::cref(key_proj()));
 		}
 
 	private:
-		inplace_vector<value_type, Capacity> heap_;
+		spill_vector<value_type, Capacity> heap_;
 };
 
 // Dial's heap. Score overflow and underflows (due to heuristic weight) fallback to `heap_t`.
@@ -156,7 +171,9 @@ class bucket_heap_t : private Projection {
 			auto& head = buckets_[ bucket_of(key) ];
 			auto index = [ & ] {
 				if (free_ == npos) {
-					pool_.emplace_back(value, head);
+					if (pool_.emplace_back(value, head)) {
+						record_heap_spill();
+					}
 					return static_cast<index_type>(pool_.size());
 				} else {
 					auto index = std::exchange(free_, pool_[ free_ - 1 ].next);
@@ -190,11 +207,206 @@ class bucket_heap_t : private Projection {
 		}
 
 		std::array<index_type, Window> buckets_;
-		inplace_vector<node_t, Capacity> pool_;
+		// Stale entries from lazy deletion can outnumber live ones on weighted searches, so both the
+		// pool and the overflow heap spill rather than throw
+		spill_vector<node_t, Capacity> pool_;
 		heap_t<Type, std::greater<>, Projection, Capacity / 8> overflow_;
 		index_type free_ = npos;
 		std::size_t bucket_size_ = 0;
 		score_type base_ = 0;
 };
 
+// Dial's heap where each bucket is a binary heap on `Tiebreak`, so that equal scores pop the lowest
+// tiebreak first. With the heuristic cost as tiebreak this expands nodes nearest the goal first,
+// which matters on open plains where most of the frontier shares a score. Scores outside the window
+// fall back to `heap_t` ordered by both keys.
+template <class Type, class Projection, class Tiebreak, std::size_t Capacity, std::size_t Window = 256>
+class tiebreak_bucket_heap_t : private Projection, private Tiebreak {
+	public:
+		using value_type = Type;
+		using key_project = Projection;
+		using tiebreak_project = Tiebreak;
+		using score_type = std::invoke_result_t<Projection, Type>;
+
+		explicit constexpr tiebreak_bucket_heap_t(key_project projection = {}, tiebreak_project tiebreak = {}) :
+				key_project{std::move(projection)},
+				tiebreak_project{std::move(tiebreak)} {}
+
+		[[nodiscard]] constexpr auto empty() const -> bool { return bucket_size_ == 0 && overflow_.empty(); }
+		[[nodiscard]] constexpr auto key_proj() const -> const key_project& { return *this; }
+		[[nodiscard]] constexpr auto tiebreak_proj() const -> const tiebreak_project& { return *this; }
+		[[nodiscard]] constexpr auto size() const -> std::size_t { return bucket_size_ + overflow_.size(); }
+
+		constexpr auto clear() -> void {
+			for (auto& bucket : buckets_) {
+				bucket.clear();
+			}
+			overflow_.clear();
+			bucket_size_ = 0;
+			base_ = 0;
+		}
+
+		[[nodiscard]] constexpr auto top() -> value_type {
+			if (bucket_size_ == 0) {
+				return overflow_.top();
+			}
+			settle();
+			if (!overflow_.empty()) {
+				auto overflow_top = overflow_.top();
+				if (key_proj()(overflow_top) < base_) {
+					return overflow_top;
+				}
+			}
+			return buckets_[ bucket_of(base_) ][ 0 ];
+		}
+
+		constexpr auto pop() -> void {
+			if (bucket_size_ == 0) {
+				base_ = std::max(base_, key_proj()(overflow_.top()));
+				overflow_.pop();
+				return;
+			}
+			settle();
+			if (!overflow_.empty() && key_proj()(overflow_.top()) < base_) {
+				overflow_.pop();
+				return;
+			}
+			auto& bucket = buckets_[ bucket_of(base_) ];
+			pop_heap(bucket, std::greater<>{}, std::cref(tiebreak_proj()));
+			bucket.pop_back();
+			--bucket_size_;
+		}
+
+		constexpr auto push(value_type value) -> void {
+			auto key = key_proj()(value);
+			if (key < base_ || key - base_ >= score_type{Window}) {
+				overflow_.push(value);
+				return;
+			}
+			auto& bucket = buckets_[ bucket_of(key) ];
+			bucket.push_back(value);
+			push_heap(bucket, std::greater<>{}, std::cref(tiebreak_proj()));
+			++bucket_size_;
+		}
+
+	private:
+		struct rank_projection {
+				constexpr auto operator()(const value_type& value) const {
+					return std::pair{std::invoke(key_project{}, value), std::invoke(tiebreak_project{}, value)};
+				}
+		};
+
+		constexpr static auto bucket_of(std::integral auto key) -> std::size_t {
+			return static_cast<std::size_t>(key) % Window;
+		}
+
+		// invariant: non-empty
+		constexpr auto settle() -> void {
+			while (buckets_[ bucket_of(base_) ].empty()) {
+				++base_;
+			}
+		}
+
+		// Buckets keep their capacity between searches
+		std::array<std::vector<value_type>, Window> buckets_;
+		heap_t<Type, std::greater<>, rank_projection, Capacity / 8> overflow_;
+		std::size_t bucket_size_ = 0;
+		score_type base_ = 0;
+};
+
+// Monotone radix heap. Bucket `n` holds keys whose highest bit differing from the last popped key
+// is `n - 1`, so each node is moved at most once per bit as the minimum rises. Keys pushed below the
+// last popped key, which weighted and jump point searches can produce, fall back to `heap_t`.
+template <class Type, class Projection, std::size_t Capacity>
+class radix_heap_t : private Projection {
+	public:
+		using value_type = Type;
+		using key_project = Projection;
+		using score_type = std::invoke_result_t<Projection, Type>;
+
+		explicit constexpr radix_heap_t(key_project projection = {}) :
+				key_project{std::move(projection)} {}
+
+		[[nodiscard]] constexpr auto empty() const -> bool { return size_ == 0 && overflow_.empty(); }
+		[[nodiscard]] constexpr auto key_proj() const -> const key_project& { return *this; }
+		[[nodiscard]] constexpr auto size() const -> std::size_t { return size_ + overflow_.size(); }
+
+		constexpr auto clear() -> void {
+			for (auto& bucket : buckets_) {
+				bucket.clear();
+			}
+			overflow_.clear();
+			size_ = 0;
+			last_ = 0;
+		}
+
+		[[nodiscard]] constexpr auto top() -> value_type {
+			if (size_ == 0) {
+				return overflow_.top();
+			}
+			settle();
+			if (!overflow_.empty()) {
+				auto overflow_top = overflow_.top();
+				if (key_of(overflow_top) < last_) {
+					return overflow_top;
+				}
+			}
+			return buckets_[ 0 ].back();
+		}
+
+		constexpr auto pop() -> void {
+			if (size_ == 0) {
+				last_ = std::max(last_, key_of(overflow_.top()));
+				overflow_.pop();
+				return;
+			}
+			settle();
+			if (!overflow_.empty() && key_of(overflow_.top()) < last_) {
+				overflow_.pop();
+				return;
+			}
+			buckets_[ 0 ].pop_back();
+			--size_;
+		}
+
+		constexpr auto push(value_type value) -> void {
+			auto key = key_of(value);
+			if (key < last_) {
+				overflow_.push(value);
+				return;
+			}
+			buckets_[ bucket_of(key) ].push_back(value);
+			++size_;
+		}
+
+	private:
+		using key_type = std::make_unsigned_t<score_type>;
+
+		[[nodiscard]] constexpr auto key_of(const value_type& value) const -> key_type {
+			return static_cast<key_type>(key_proj()(value));
+		}
+
+		[[nodiscard]] constexpr auto bucket_of(key_type key) const -> std::size_t {
+			return std::bit_width(static_cast<key_type>(key ^ last_));
+		}
+
+		// Raises `last_` to the smallest key and redistributes its bucket. invariant: non-empty
+		constexpr auto settle() -> void {
+			if (!buckets_[ 0 ].empty()) {
+				return;
+			}
+			auto& bucket = *std::ranges::find_if(buckets_, [](const auto& bucket) { return !bucket.empty(); });
+			last_ = std::ranges::min(bucket | std::views::transform([ & ](const value_type& value) { return key_of(value); }));
+			for (const auto& value : bucket) {
+				buckets_[ bucket_of(key_of(value)) ].push_back(value);
+			}
+			bucket.clear();
+		}
+
+		std::array<std::vector<value_type>, std::numeric_limits<key_type>::digits + 1> buckets_;
+		heap_t<Type, std::greater<>, Projection, Capacity / 8> overflow_;
+		std::size_t size_ = 0;
+		key_type last_ = 0;
+};
+
 } // namespace screeps
@@ -1,9 +1,137 @@
+module;
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 export module screeps:heuristic;
+import :landmarks;
 import :position;
 import std;
 
 namespace screeps {
 
+#if defined(__x86_64__)
+// The module is built for baseline x86-64, so the AVX2 kernel is picked at runtime
+inline const bool has_avx2 = [] {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+}();
+#endif
+
+// Multi-goal Chebyshev distance kernel. Goals are stored as structure-of-arrays and padded to a
+// whole number of vector lanes with goals which are too far away to matter. The lanes are shared
+// between copies, since heuristics are copied into each search.
+class goal_lanes {
+	public:
+		constexpr static auto lanes = std::size_t{8};
+
+		goal_lanes() = default;
+		explicit goal_lanes(const auto& goals) {
+			auto size = (goals.size() + lanes - 1) / lanes * lanes;
+			auto data = std::make_shared<lanes_type>();
+			data->xx.resize(size, k_far);
+			data->yy.resize(size, k_far);
+			data->range.resize(size, 0);
+			for (const auto& [ ii, goal ] : std::views::enumerate(goals)) {
+				data->xx[ ii ] = goal.pos.xx;
+				data->yy[ ii ] = goal.pos.yy;
+				data->range[ ii ] = goal.range;
+			}
+			data_ = std::move(data);
+		}
+
+		// Returns the minimum of `distance - range` over all goals, or `int` max if there are none
+		[[nodiscard]] auto min_excess(world_position_t pos) const -> int {
+			return fold<false>(pos);
+		}
+
+		// Returns the maximum of `range - distance` over all goals, or 0
+		[[nodiscard]] auto max_deficit(world_position_t pos) const -> int {
+			return fold<true>(pos);
+		}
+
+	private:
+		struct lanes_type {
+				std::vector<int> xx;
+				std::vector<int> yy;
+				std::vector<int> range;
+		};
+
+		// World coordinates are less than 12800, so this is out of range of everything
+		constexpr static auto k_far = 1 << 20;
+
+		template <bool Flee>
+		constexpr static auto initial = Flee ? 0 : std::numeric_limits<int>::max();
+
+		template <bool Flee>
+		[[nodiscard]] auto fold(world_position_t pos) const -> int {
+			const auto& data = *data_;
+#if defined(__x86_64__)
+			if (has_avx2) {
+				return fold_avx2<Flee>(data, pos);
+			}
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+			auto pos_xx = vdupq_n_s32(pos.xx);
+			auto pos_yy = vdupq_n_s32(pos.yy);
+			auto result = vdupq_n_s32(initial<Flee>);
+			for (std::size_t ii = 0; ii < data.xx.size(); ii += 4) {
+				auto distance = vmaxq_s32(vabdq_s32(vld1q_s32(&data.xx[ ii ]), pos_xx), vabdq_s32(vld1q_s32(&data.yy[ ii ]), pos_yy));
+				auto range = vld1q_s32(&data.range[ ii ]);
+				if constexpr (Flee) {
+					result = vmaxq_s32(result, vsubq_s32(range, distance));
+				} else {
+					result = vminq_s32(result, vsubq_s32(distance, range));
+				}
+			}
+			return Flee ? vmaxvq_s32(result) : vminvq_s32(result);
+#else
+			// Fixed-width lanes which the compiler can keep in vector registers
+			auto folded = std::array<int, lanes>{};
+			folded.fill(initial<Flee>);
+			for (std::size_t ii = 0; ii < data.xx.size(); ii += lanes) {
+				for (std::size_t jj = 0; jj < lanes; ++jj) {
+					auto distance = std::max(std::abs(data.xx[ ii + jj ] - pos.xx), std::abs(data.yy[ ii + jj ] - pos.yy));
+					if constexpr (Flee) {
+						folded[ jj ] = std::max(folded[ jj ], data.range[ ii + jj ] - distance);
+					} else {
+						folded[ jj ] = std::min(folded[ jj ], distance - data.range[ ii + jj ]);
+					}
+				}
+			}
+			return Flee ? std::ranges::max(folded) : std::ranges::min(folded);
+#endif
+		}
+
+#if defined(__x86_64__)
+		template <bool Flee>
+		[[nodiscard, gnu::target("avx2")]] static auto fold_avx2(const lanes_type& data, world_position_t pos) -> int {
+			// NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+			auto pos_xx = _mm256_set1_epi32(pos.xx);
+			auto pos_yy = _mm256_set1_epi32(pos.yy);
+			auto result = _mm256_set1_epi32(initial<Flee>);
+			for (std::size_t ii = 0; ii < data.xx.size(); ii += lanes) {
+				auto dx = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data.xx[ ii ])), pos_xx));
+				auto dy = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data.yy[ ii ])), pos_yy));
+				auto range = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data.range[ ii ]));
+				auto distance = _mm256_max_epi32(dx, dy);
+				if constexpr (Flee) {
+					result = _mm256_max_epi32(result, _mm256_sub_epi32(range, distance));
+				} else {
+					result = _mm256_min_epi32(result, _mm256_sub_epi32(distance, range));
+				}
+			}
+			auto folded = std::array<int, lanes>{};
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(folded.data()), result);
+			// NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+			return Flee ? std::ranges::max(folded) : std::ranges::min(folded);
+		}
+#endif
+
+		std::shared_ptr<const lanes_type> data_;
+};
+
 // Destination heuristic manager
 export class heuristic_t {
 	public:
@@ -11,6 +139,8 @@ export class heuristic_t {
 				cost_t range{};
 				world_position_t pos;
 
+				constexpr auto operator==(const goal_t& right) const -> bool = default;
+
 				constexpr static auto struct_template = js::struct_template{
 					js::struct_member{util::cw<"pos">, &goal_t::pos},
 					js::struct_member{util::cw<"range">, &goal_t::range},
@@ -23,7 +153,8 @@ export class heuristic_t {
 
 		constexpr heuristic_t(std::span<const goal_t> goals, bool flee) :
 				callback_{flee ? &heuristic_t::flee_n : &heuristic_t::forward_n},
-				goals_{goals} {}
+				goals_{goals},
+				lanes_{goals} {}
 
 		// Returns the minimum Chebyshev distance to a goal
 		[[nodiscard]] constexpr auto operator()(world_position_t pos) const -> cost_t {
@@ -35,6 +166,59 @@ export class heuristic_t {
 			return (*this)(world_position_t{pos});
 		}
 
+		// Returns every goal, which may be none
+		[[nodiscard]] constexpr auto goals() const -> std::span<const goal_t> {
+			return is_n() ? goals_ : std::span{&one_goal_, 1};
+		}
+
+		// Returns true for flee searches
+		[[nodiscard]] constexpr auto flee() const -> bool {
+			return callback_ == &heuristic_t::flee_one || callback_ == &heuristic_t::flee_n;
+		}
+
+		// Returns the goal of a single-goal forward search, or `nullptr` for flee and multi-goal
+		// searches
+		[[nodiscard]] constexpr auto forward_goal() const -> const goal_t* {
+			return is_forward_one() ? &one_goal_ : nullptr;
+		}
+
+		// Tightens a single-goal forward heuristic with landmark bounds. `landmarks` must outlive this
+		// heuristic and every copy of it.
+		constexpr auto with_landmarks(const landmark_bounds& landmarks) -> void {
+			if (is_forward_one()) {
+				callback_ = &heuristic_t::forward_landmarks;
+				landmarks_ = &landmarks;
+			}
+		}
+
+		// Returns the first step, up to `length`, along a straight line from `pos` at which the heuristic
+		// is zero. Only `dx` or `dy` may be non-zero.
+		[[nodiscard]] constexpr auto first_zero(const world_position_t& pos, int dx, int dy, int length) const -> std::optional<int> {
+			auto step = [ & ] -> int {
+				if (is_forward_one()) {
+					// Landmark bounds are zero within range, so they don't move the first zero
+					return first_in_range(pos, dx, dy, one_goal_);
+				} else if (callback_ == &heuristic_t::forward_n) {
+					auto steps = goals_ | std::views::transform([ & ](const goal_t& goal) -> int {
+						return first_in_range(pos, dx, dy, goal);
+					});
+					return std::ranges::fold_left(steps, std::numeric_limits<int>::max(), std::ranges::min);
+				} else {
+					for (int ii = 0; ii <= length; ++ii) {
+						if ((*this)(world_position_t{pos.xx + (ii * dx), pos.yy + (ii * dy)}) == 0) {
+							return ii;
+						}
+					}
+					return std::numeric_limits<int>::max();
+				}
+			}();
+			return step <= length ? std::optional{step} : std::nullopt;
+		}
+
+		// Invokes `function` with a copy of this heuristic which makes no indirect calls
+		template <class Function>
+		constexpr auto specialize(Function function) const -> decltype(auto);
+
 		// Extract 1 or N goals from passed runtime array, avoiding `std::vector` allocation in the
 		// common 1 case.
 		template <class Lock, class Range>
@@ -52,11 +236,29 @@ export class heuristic_t {
 		}
 
 	private:
+		[[nodiscard]] constexpr auto is_forward_one() const -> bool {
+			return callback_ == &heuristic_t::forward_one || callback_ == &heuristic_t::forward_landmarks;
+		}
+
+		[[nodiscard]] constexpr auto is_n() const -> bool {
+			return callback_ == &heuristic_t::forward_n || callback_ == &heuristic_t::flee_n;
+		}
+
+		// Distance along a straight line to the first tile in range of `goal`, or `int` max
+		[[nodiscard]] constexpr static auto first_in_range(const world_position_t& pos, int dx, int dy, const goal_t& goal) -> int {
+			auto along = dx == 0 ? pos.yy : pos.xx;
+			auto across = dx == 0 ? pos.xx : pos.yy;
+			auto goal_along = dx == 0 ? goal.pos.yy : goal.pos.xx;
+			auto goal_across = dx == 0 ? goal.pos.xx : goal.pos.yy;
+			auto ahead = (goal_along - along) * (dx + dy);
+			if (std::abs(across - goal_across) > goal.range || ahead < -goal.range) {
+				return std::numeric_limits<int>::max();
+			}
+			return std::max(ahead - goal.range, 0);
+		}
+
 		[[nodiscard]] constexpr auto flee_n(world_position_t pos) const -> cost_t {
-			return std::ranges::fold_left(goals_, cost_t{0}, [ & ](cost_t cost, goal_t goal) -> cost_t {
-				auto dist = pos.range_to(goal.pos);
-				return dist < goal.range ? std::max(cost, goal.range - dist) : cost;
-			});
+			return lanes_.max_deficit(pos);
 		}
 
 		[[nodiscard]] constexpr auto flee_one(world_position_t pos) const -> cost_t {
@@ -64,21 +266,57 @@ export class heuristic_t {
 		}
 
 		[[nodiscard]] constexpr auto forward_n(world_position_t pos) const -> cost_t {
-			return std::ranges::fold_left(goals_, std::numeric_limits<cost_t>::max(), [ & ](cost_t cost, goal_t goal) -> cost_t {
-				auto dist = pos.range_to(goal.pos);
-				return (dist > goal.range) ? std::min(cost, dist - goal.range) : 0;
-			});
+			return std::max(lanes_.min_excess(pos), 0);
 		}
 
 		[[nodiscard]] constexpr auto forward_one(world_position_t pos) const -> cost_t {
 			return std::max(pos.range_to(one_goal_.pos) - one_goal_.range, 0);
 		}
 
+		[[nodiscard]] constexpr auto forward_landmarks(world_position_t pos) const -> cost_t {
+			return std::max(forward_one(pos), (*landmarks_)(pos));
+		}
+
 		using callback_type = auto (heuristic_t::*)(world_position_t) const -> cost_t;
+		template <callback_type Callback>
+		class specialized;
 
 		callback_type callback_;
 		std::span<const goal_t> goals_;
+		goal_lanes lanes_;
 		goal_t one_goal_;
+		const landmark_bounds* landmarks_{};
+};
+
+// A heuristic whose callback is fixed at compile time, so that it can be inlined into the search
+template <heuristic_t::callback_type Callback>
+class heuristic_t::specialized : public heuristic_t {
+	public:
+		explicit constexpr specialized(const heuristic_t& heuristic) : heuristic_t{heuristic} {}
+
+		[[nodiscard]] constexpr auto operator()(world_position_t pos) const -> cost_t {
+			return (this->*Callback)(pos);
+		}
+
+		[[nodiscard]] constexpr auto operator()(indexed_position_t pos) const -> cost_t {
+			// NOLINTNEXTLINE(cppcoreguidelines-slicing)
+			return (*this)(world_position_t{pos});
+		}
 };
 
+template <class Function>
+constexpr auto heuristic_t::specialize(Function function) const -> decltype(auto) {
+	if (callback_ == &heuristic_t::forward_one) {
+		return function(specialized<&heuristic_t::forward_one>{*this});
+	} else if (callback_ == &heuristic_t::forward_landmarks) {
+		return function(specialized<&heuristic_t::forward_landmarks>{*this});
+	} else if (callback_ == &heuristic_t::forward_n) {
+		return function(specialized<&heuristic_t::forward_n>{*this});
+	} else if (callback_ == &heuristic_t::flee_one) {
+		return function(specialized<&heuristic_t::flee_one>{*this});
+	} else {
+		return function(specialized<&heuristic_t::flee_n>{*this});
+	}
+}
+
 } // namespace screeps
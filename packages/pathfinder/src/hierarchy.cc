@@ -0,0 +1,139 @@
+export module screeps:hierarchy;
+import :room;
+import std;
+
+namespace screeps {
+
+// The abstract graph is built once for the default `plainCost` and `swampCost`. It only guides
+// which rooms are searched, so other costs still produce correct paths.
+constexpr auto hierarchy_look_table = terrain_cost_type{{1, obstacle, 5, obstacle}};
+constexpr auto unreachable = std::numeric_limits<cost_t>::max();
+
+// Room sides, in the same order as the `k_exit_*` bits
+enum class room_side : std::uint8_t {
+	top,
+	right,
+	bottom,
+	left
+};
+
+// A run of consecutive walkable tiles along one side of a room
+struct entrance_t {
+		// Offset of the tile which represents this entrance in the abstract graph
+		[[nodiscard]] constexpr auto offset() const -> unsigned { return (unsigned{first} + last) / 2; }
+
+		[[nodiscard]] constexpr auto xx() const -> unsigned {
+			switch (side) {
+				case room_side::right: return 49;
+				case room_side::left: return 0;
+				default: return offset();
+			}
+		}
+
+		[[nodiscard]] constexpr auto yy() const -> unsigned {
+			switch (side) {
+				case room_side::top: return 0;
+				case room_side::bottom: return 49;
+				default: return offset();
+			}
+		}
+
+		room_side side;
+		std::uint8_t first;
+		std::uint8_t last;
+};
+
+// Terrain distance from one tile to every other tile in a room, `unreachable` for walls and
+// enclosed tiles
+using room_distances_type = std::array<cost_t, 50 * 50>;
+auto room_distances(terrain_type terrain, unsigned origin_xx, unsigned origin_yy) -> room_distances_type {
+	auto look = room_terrain{terrain, nullptr};
+	auto distances = room_distances_type{};
+	std::ranges::fill(distances, unreachable);
+	using node_type = std::pair<cost_t, unsigned>;
+	auto heap = std::priority_queue<node_type, std::vector<node_type>, std::greater<>>{};
+	auto origin = (origin_yy * 50) + origin_xx;
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+	distances[ origin ] = 0;
+	heap.emplace(0, origin);
+	while (!heap.empty()) {
+		auto [ cost, index ] = heap.top();
+		heap.pop();
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		if (distances[ index ] != cost) {
+			continue;
+		}
+		int xx = index % 50;
+		int yy = index / 50;
+		for (auto dy = -1; dy <= 1; ++dy) {
+			for (auto dx = -1; dx <= 1; ++dx) {
+				auto nx = xx + dx;
+				auto ny = yy + dy;
+				if ((dx == 0 && dy == 0) || nx < 0 || nx >= 50 || ny < 0 || ny >= 50) {
+					continue;
+				}
+				auto step = look(hierarchy_look_table, nx, ny);
+				auto next = static_cast<unsigned>((ny * 50) + nx);
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+				if (step != obstacle && cost + step < distances[ next ]) {
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+					distances[ next ] = cost + step;
+					heap.emplace(cost + step, next);
+				}
+			}
+		}
+	}
+	return distances;
+}
+
+// Entrances of one room and the terrain distances between each pair of them
+struct room_graph_t {
+		[[nodiscard]] auto distance(std::size_t from, std::size_t to) const -> cost_t {
+			return distances[ (from * entrances.size()) + to ];
+		}
+
+		std::vector<entrance_t> entrances;
+		std::vector<cost_t> distances;
+};
+
+auto make_room_graph(terrain_type terrain) -> room_graph_t {
+	auto look = room_terrain{terrain, nullptr};
+	auto graph = room_graph_t{};
+
+	// Split each side into runs of walkable tiles
+	for (auto side : {room_side::top, room_side::right, room_side::bottom, room_side::left}) {
+		auto run = std::optional<entrance_t>{};
+		for (std::uint8_t ii = 0; ii < 50; ++ii) {
+			auto tile = entrance_t{.side = side, .first = ii, .last = ii};
+			if (look(hierarchy_look_table, tile.xx(), tile.yy()) == obstacle) {
+				if (run) {
+					graph.entrances.push_back(*run);
+					run.reset();
+				}
+			} else if (run) {
+				run->last = ii;
+			} else {
+				run = tile;
+			}
+		}
+		if (run) {
+			graph.entrances.push_back(*run);
+		}
+	}
+
+	// Connect each pair of entrances
+	auto size = graph.entrances.size();
+	graph.distances.resize(size * size);
+	for (std::size_t ii = 0; ii < size; ++ii) {
+		const auto& from = graph.entrances[ ii ];
+		auto distances = room_distances(terrain, from.xx(), from.yy());
+		for (std::size_t jj = 0; jj < size; ++jj) {
+			const auto& to = graph.entrances[ jj ];
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			graph.distances[ (ii * size) + jj ] = distances[ (to.yy() * 50) + to.xx() ];
+		}
+	}
+	return graph;
+}
+
+} // namespace screeps
@@ -9,17 +9,49 @@ using namespace screeps;
 using namespace std::string_view_literals;
 namespace napi = js::napi;
 
-constexpr auto k_max_rooms = 64;
-
 constexpr auto string_literals = std::tuple{
+	"bidirectional"sv,
+	"callbackTime"sv,
+	"callbacks"sv,
+	"checkInterval"sv,
 	"cost"sv,
+	"expandTime"sv,
+	"flee"sv,
+	"goals"sv,
+	"heuristicWeight"sv,
+	"hierarchical"sv,
 	"incomplete"sv,
+	"jumpLength"sv,
+	"jumps"sv,
+	"landmarks"sv,
+	"length"sv,
+	"matrix"sv,
+	"maxCost"sv,
+	"maxOps"sv,
+	"maxRooms"sv,
+	"maxTime"sv,
 	"ops"sv,
+	"opsHistogram"sv,
+	"options"sv,
+	"origin"sv,
 	"path"sv,
+	"plainCost"sv,
+	"popped"sv,
 	"pos"sv,
+	"pushed"sv,
 	"range"sv,
 	"room"sv,
+	"roomsBlocked"sv,
+	"roomsOpened"sv,
+	"searches"sv,
+	"spills"sv,
+	"stale"sv,
+	"store"sv,
+	"swampCost"sv,
 	"terrain"sv,
+	"timeHistogram"sv,
+	"totalTime"sv,
+	"variant"sv,
 };
 
 // napi environment (string table) and callback type
@@ -33,11 +65,32 @@ class environment
 class napi_room_callback {
 	public:
 		napi_room_callback() = default;
-		explicit napi_room_callback(napi::environment& env, napi::local_of<js::function_tag> maybe_room_callback) :
+		explicit napi_room_callback(napi::environment& env, napi::local_of<js::function_tag> maybe_room_callback, room_callback_cache* cache = nullptr) :
 				env_{&env},
-				maybe_room_callback{maybe_room_callback} {}
+				maybe_room_callback{maybe_room_callback},
+				cache_{cache} {}
 
 		auto operator()(room_location_t room) -> room_callback_result_type {
+			if (cache_ == nullptr) {
+				return invoke(room);
+			} else {
+				return (*cache_)(room, [ this ](room_location_t location) -> room_callback_result_type { return invoke(location); });
+			}
+		}
+
+		// What a search would see of `room`, for `path_cache`. Rooms resolved from preloaded or stored
+		// matrices don't invoke the room callback.
+		auto state(room_location_t room) -> room_state {
+			if (cache_ == nullptr) {
+				return room_state{invoke(room)};
+			} else {
+				(*this)(room);
+				return cache_->state(room);
+			}
+		}
+
+	private:
+		auto invoke(room_location_t room) -> room_callback_result_type {
 			if (maybe_room_callback) {
 				return maybe_room_callback->call<room_callback_result_type>(*env_, room);
 			} else {
@@ -45,20 +98,41 @@ class napi_room_callback {
 			}
 		}
 
-	private:
 		napi::environment* env_{};
 		napi::local_of<js::function_tag> maybe_room_callback;
+		room_callback_cache* cache_{};
 };
 
 // @isolated-vm/experimental callback type
 class isolated_vm_room_callback {
 	public:
 		isolated_vm_room_callback() = default;
-		explicit isolated_vm_room_callback(const isolated_vm::runtime_lock& lock, isolated_vm::local_of<js::function_tag> maybe_room_callback) :
+		explicit isolated_vm_room_callback(const isolated_vm::runtime_lock& lock, isolated_vm::local_of<js::function_tag> maybe_room_callback, room_callback_cache* cache = nullptr) :
 				lock_{&lock},
-				maybe_room_callback{maybe_room_callback} {}
+				maybe_room_callback{maybe_room_callback},
+				cache_{cache} {}
 
 		auto operator()(room_location_t room) -> room_callback_result_type {
+			if (cache_ == nullptr) {
+				return invoke(room);
+			} else {
+				return (*cache_)(room, [ this ](room_location_t location) -> room_callback_result_type { return invoke(location); });
+			}
+		}
+
+		// What a search would see of `room`, for `path_cache`. Rooms resolved from preloaded or stored
+		// matrices don't invoke the room callback.
+		auto state(room_location_t room) -> room_state {
+			if (cache_ == nullptr) {
+				return room_state{invoke(room)};
+			} else {
+				(*this)(room);
+				return cache_->state(room);
+			}
+		}
+
+	private:
+		auto invoke(room_location_t room) -> room_callback_result_type {
 			if (maybe_room_callback) {
 				return maybe_room_callback->call<room_callback_result_type>(*lock_, room);
 			} else {
@@ -66,9 +140,9 @@ class isolated_vm_room_callback {
 			}
 		}
 
-	private:
 		const isolated_vm::runtime_lock* lock_{};
 		isolated_vm::local_of<js::function_tag> maybe_room_callback;
+		room_callback_cache* cache_{};
 };
 
 auto check_termination() -> void {}
@@ -85,6 +159,18 @@ pathfinder_stack_type<Callback> pathfinders;
 template thread_local pathfinder_stack_type<napi_room_callback> pathfinders<napi_room_callback>;
 template thread_local pathfinder_stack_type<isolated_vm_room_callback> pathfinders<isolated_vm_room_callback>;
 
+// Results which are known before `room_callback` is invoked. Returns false if there are none. Matrix
+// stores are only implemented by the nodejs module.
+auto preload(room_callback_cache& cache, const std::optional<std::vector<room_matrix>>& matrices, std::optional<stored_matrices> stored) -> bool {
+	if (stored) {
+		throw js::runtime_error{u"matrix stores are not available in this context"};
+	}
+	if (matrices) {
+		cache.preload(*matrices);
+	}
+	return matrices.has_value();
+}
+
 template <class Lock, template <class> class LocalOf, template <class> class ValueOf, class Callback>
 auto search(
 	Lock lock,
@@ -98,15 +184,24 @@ auto search(
 	int max_ops,
 	int max_cost,
 	bool flee,
-	double heuristic_weight
+	double heuristic_weight,
+	bool bidirectional,
+	bool hierarchical,
+	bool landmarks,
+	int max_time,
+	int check_interval,
+	std::optional<std::vector<room_matrix>> matrices,
+	std::optional<stored_matrices> stored
 ) -> std::optional<result> {
 	auto [ heuristic, storage ] = heuristic_t::make_from_runtime(lock, goals, flee);
+	auto preloaded = room_callback_cache{};
+	auto has_preloaded = preload(preloaded, matrices, stored);
 	return pathfinders<Callback>(util::overloaded{
 		[]() -> std::optional<result> { throw js::runtime_error{u"too many concurrent pathfinder searches"}; },
 		[ & ](auto& pf) -> std::optional<result> {
 			// Run the search
 			return pf.search(
-				Callback{lock, *room_callback.value_or({})},
+				Callback{lock, *room_callback.value_or({}), has_preloaded ? &preloaded : nullptr},
 				origin,
 				heuristic,
 				{
@@ -116,7 +211,171 @@ auto search(
 					.max_cost = max_cost,
 					.max_ops = max_ops,
 					.max_rooms = max_rooms,
+					.max_time = max_time,
+					.check_interval = check_interval,
+					.bidirectional = bidirectional,
+					.hierarchical = hierarchical,
+					.landmarks = landmarks,
+					.terrain_only = !room_callback && !has_preloaded,
+				}
+			);
+		}
+	});
+}
+
+// Same as `search`, but repeated queries are answered from this thread's `path_cache` while the
+// room callback returns the same results
+template <class Lock, template <class> class LocalOf, template <class> class ValueOf, class Callback>
+auto search_cached(
+	Lock lock,
+	int time,
+	world_position_t origin,
+	ValueOf<js::list_tag> goals,
+	std::optional<js::forward<LocalOf<js::function_tag>>> room_callback,
+	// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+	int plain_cost,
+	int swamp_cost,
+	int max_rooms,
+	int max_ops,
+	int max_cost,
+	bool flee,
+	double heuristic_weight,
+	bool bidirectional,
+	bool hierarchical,
+	bool landmarks,
+	int max_time,
+	int check_interval,
+	std::optional<std::vector<room_matrix>> matrices,
+	std::optional<stored_matrices> stored
+) -> std::optional<batch_result> {
+	auto [ heuristic, storage ] = heuristic_t::make_from_runtime(lock, goals, flee);
+	auto preloaded = room_callback_cache{};
+	auto has_preloaded = preload(preloaded, matrices, stored);
+	auto validate = Callback{lock, *room_callback.value_or({}), has_preloaded ? &preloaded : nullptr};
+	return thread_path_cache()(
+		time,
+		validate,
+		origin,
+		heuristic,
+		{
+			.heuristic_weight = heuristic_weight,
+			.plain_cost = plain_cost,
+			.swamp_cost = swamp_cost,
+			.max_cost = max_cost,
+			.max_ops = max_ops,
+			.max_rooms = max_rooms,
+			.max_time = max_time,
+			.check_interval = check_interval,
+			.bidirectional = bidirectional,
+			.hierarchical = hierarchical,
+			.landmarks = landmarks,
+			.terrain_only = !room_callback && !has_preloaded,
+		},
+		[ & ](room_callback_cache& resolved, const auto& options) -> std::optional<result> {
+			preload(resolved, matrices, stored);
+			return pathfinders<Callback>(util::overloaded{
+				[]() -> std::optional<result> { throw js::runtime_error{u"too many concurrent pathfinder searches"}; },
+				[ & ](auto& pf) -> std::optional<result> {
+					return pf.search(Callback{lock, *room_callback.value_or({}), &resolved}, origin, heuristic, options);
 				}
+			});
+		}
+	);
+}
+
+// Same as `search`, or `search_cached` if `time` is given, but the path is expanded tile by tile
+// into `positions` and `directions` instead of being returned as an array of jump points. `time`
+// is ignored unless `Cached` is set, which it isn't for sandboxes since they share the thread's
+// path cache.
+template <class Lock, template <class> class LocalOf, template <class> class ValueOf, class Callback, bool Cached = true>
+auto search_packed(
+	Lock lock,
+	std::optional<int> time,
+	world_position_t origin,
+	ValueOf<js::list_tag> goals,
+	std::optional<js::forward<LocalOf<js::function_tag>>> room_callback,
+	// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+	int plain_cost,
+	int swamp_cost,
+	int max_rooms,
+	int max_ops,
+	int max_cost,
+	bool flee,
+	double heuristic_weight,
+	bool bidirectional,
+	bool hierarchical,
+	bool landmarks,
+	int max_time,
+	int check_interval,
+	std::optional<std::vector<room_matrix>> matrices,
+	std::optional<stored_matrices> stored,
+	std::span<std::int32_t> positions,
+	std::optional<std::span<std::uint8_t>> directions
+) -> std::optional<packed_result> {
+	auto pack = [ & ](const auto& result) -> std::optional<packed_result> {
+		if (!result) {
+			return std::nullopt;
+		}
+		return packed_result{
+			.cost = result->cost,
+			.length = write_path(result->path, positions, directions.value_or(std::span<std::uint8_t>{})),
+			.ops = result->ops,
+			.incomplete = result->incomplete,
+		};
+	};
+	if (Cached && time) {
+		return pack(search_cached<Lock, LocalOf, ValueOf, Callback>(lock, *time, origin, goals, std::move(room_callback), plain_cost, swamp_cost, max_rooms, max_ops, max_cost, flee, heuristic_weight, bidirectional, hierarchical, landmarks, max_time, check_interval, std::move(matrices), stored));
+	} else {
+		return pack(search<Lock, LocalOf, ValueOf, Callback>(lock, origin, goals, std::move(room_callback), plain_cost, swamp_cost, max_rooms, max_ops, max_cost, flee, heuristic_weight, bidirectional, hierarchical, landmarks, max_time, check_interval, std::move(matrices), stored));
+	}
+}
+
+template <class Lock, template <class> class LocalOf, class Callback>
+auto search_many(
+	Lock lock,
+	std::vector<batch_query> queries,
+	std::optional<js::forward<LocalOf<js::function_tag>>> room_callback
+) -> std::vector<batch_result> {
+	return pathfinders<Callback>(util::overloaded{
+		[]() -> std::vector<batch_result> { throw js::runtime_error{u"too many concurrent pathfinder searches"}; },
+		[ & ](auto& pf) -> std::vector<batch_result> {
+			// Rooms are resolved once for the whole batch
+			auto cache = room_callback_cache{};
+			return pf.search_many(Callback{lock, *room_callback.value_or({}), &cache}, queries);
+		}
+	});
+}
+
+template <class Lock, template <class> class LocalOf, template <class> class ValueOf, class Callback>
+auto distance_field(
+	Lock lock,
+	ValueOf<js::list_tag> goals,
+	std::optional<js::forward<LocalOf<js::function_tag>>> room_callback,
+	// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+	int plain_cost,
+	int swamp_cost,
+	int max_rooms,
+	int max_ops,
+	int max_cost,
+	std::span<std::uint16_t> distances,
+	std::span<std::uint8_t> directions
+) -> std::vector<room_location_t> {
+	auto [ heuristic, storage ] = heuristic_t::make_from_runtime(lock, goals, false);
+	return pathfinders<Callback>(util::overloaded{
+		[]() -> std::vector<room_location_t> { throw js::runtime_error{u"too many concurrent pathfinder searches"}; },
+		[ & ](auto& pf) -> std::vector<room_location_t> {
+			return pf.distance_field(
+				Callback{lock, *room_callback.value_or({})},
+				heuristic,
+				{
+					.plain_cost = plain_cost,
+					.swamp_cost = swamp_cost,
+					.max_cost = max_cost,
+					.max_ops = max_ops,
+					.max_rooms = max_rooms,
+				},
+				distances,
+				directions
 			);
 		}
 	});
@@ -127,11 +386,28 @@ js::napi::napi_js_module module_namespace{
 	std::type_identity<environment>{},
 	[](auto& /*env*/) -> auto {
 		constexpr auto search = ::search<environment&, napi::local_of, napi::value_of, napi_room_callback>;
+		constexpr auto search_cached = ::search_cached<environment&, napi::local_of, napi::value_of, napi_room_callback>;
+		constexpr auto distance_field = ::distance_field<environment&, napi::local_of, napi::value_of, napi_room_callback>;
+		constexpr auto search_many = ::search_many<environment&, napi::local_of, napi_room_callback>;
+		constexpr auto search_packed = ::search_packed<environment&, napi::local_of, napi::value_of, napi_room_callback>;
 		return std::tuple{
 			std::in_place,
+			std::pair{util::cw<"configureParallelSearch">, js::free_function{configure_parallel_search}},
+			std::pair{util::cw<"configurePathCache">, js::free_function{configure_path_cache}},
+			std::pair{util::cw<"distanceField">, js::free_function{distance_field}},
+			std::pair{util::cw<"findRoute">, js::free_function{find_route}},
 			std::pair{util::cw<"loadTerrain">, js::free_function{load_terrain}},
+			std::pair{util::cw<"loadTerrainFile">, js::free_function{load_terrain_file}},
+			std::pair{util::cw<"maxRooms">, static_cast<int>(k_max_rooms)},
+			std::pair{util::cw<"saveTerrainFile">, js::free_function{save_terrain_file}},
 			std::pair{util::cw<"search">, js::free_function{search}},
-			std::pair{util::cw<"version">, 12},
+			std::pair{util::cw<"searchCached">, js::free_function{search_cached}},
+			std::pair{util::cw<"searchMany">, js::free_function{search_many}},
+			std::pair{util::cw<"searchPacked">, js::free_function{search_packed}},
+			std::pair{util::cw<"searchParallel">, js::free_function{search_parallel}},
+			std::pair{util::cw<"searchStats">, js::free_function{last_search_stats}},
+			std::pair{util::cw<"stats">, js::free_function{process_stats}},
+			std::pair{util::cw<"version">, 29},
 		};
 	}
 };
@@ -141,10 +417,19 @@ isolated_vm::addon sandbox_namespace{
 	std::type_identity<std::monostate>{},
 	[]() -> auto {
 		constexpr auto search = ::search<const isolated_vm::runtime_lock&, isolated_vm::local_of, isolated_vm::value_of, isolated_vm_room_callback>;
+		constexpr auto distance_field = ::distance_field<const isolated_vm::runtime_lock&, isolated_vm::local_of, isolated_vm::value_of, isolated_vm_room_callback>;
+		constexpr auto search_many = ::search_many<const isolated_vm::runtime_lock&, isolated_vm::local_of, isolated_vm_room_callback>;
+		constexpr auto search_packed = ::search_packed<const isolated_vm::runtime_lock&, isolated_vm::local_of, isolated_vm::value_of, isolated_vm_room_callback, false>;
 		return std::tuple{
 			std::in_place,
+			std::pair{util::cw<"distanceField">, js::free_function{distance_field}},
+			std::pair{util::cw<"findRoute">, js::free_function{find_route}},
+			std::pair{util::cw<"maxRooms">, static_cast<int>(k_max_rooms)},
 			std::pair{util::cw<"search">, js::free_function{search}},
-			std::pair{util::cw<"version">, 12},
+			std::pair{util::cw<"searchMany">, js::free_function{search_many}},
+			std::pair{util::cw<"searchPacked">, js::free_function{search_packed}},
+			std::pair{util::cw<"searchStats">, js::free_function{last_search_stats}},
+			std::pair{util::cw<"version">, 29},
 		};
 	}
 };
@@ -7,9 +7,30 @@ namespace screeps {
 
 // ~ JPS dragons ~
 
+// Straight jump answered by a `jump_table_t` or `jump_bits_t`. The table gives where the jump stops,
+// and the heuristic may stop it sooner.
+template <jps_pathfinder Type>
+auto jump_precomputed(Type& pf, const auto& table, indexed_position_t pos, int dx, int dy) -> indexed_position_t {
+	auto [ distance, dead ] = table(pos.xx % 50, pos.yy % 50, dx, dy);
+	auto goal = pf.heuristic.first_zero(pos, dx, dy, distance);
+	if (goal) {
+		distance = *goal;
+	} else if (dead) {
+		return {};
+	}
+	pos.xx += distance * dx;
+	pos.yy += distance * dy;
+	return pos;
+}
+
 template <jps_pathfinder Type>
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 auto jump_x(Type& pf, indexed_position_t pos, int dx, cost_t cost) -> indexed_position_t {
+	if (const auto* table = pf.jump_table(pos); table != nullptr && pf.look(pos) == cost) {
+		return jump_precomputed(pf, *table, pos, dx, 0);
+	} else if (const auto& bits = pf.jump_bits(pos); bits.run_cost() == cost) {
+		return jump_precomputed(pf, bits, pos, dx, 0);
+	}
 	cost_t prev_cost_u = pf.look(pos.translate(0, -1));
 	cost_t prev_cost_d = pf.look(pos.translate(0, 1));
 	while (true) {
@@ -43,6 +64,11 @@ auto jump_x(Type& pf, indexed_position_t pos, int dx, cost_t cost) -> indexed_po
 template <jps_pathfinder Type>
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 auto jump_y(Type& pf, indexed_position_t pos, int dy, cost_t cost) -> indexed_position_t {
+	if (const auto* table = pf.jump_table(pos); table != nullptr && pf.look(pos) == cost) {
+		return jump_precomputed(pf, *table, pos, 0, dy);
+	} else if (const auto& bits = pf.jump_bits(pos); bits.run_cost() == cost) {
+		return jump_precomputed(pf, bits, pos, 0, dy);
+	}
 	cost_t prev_cost_l = pf.look(pos.translate(-1, 0));
 	cost_t prev_cost_r = pf.look(pos.translate(1, 0));
 	while (true) {
@@ -140,6 +166,8 @@ auto jump_neighbor(Type& pf, indexed_position_t neighbor, const indexed_position
 			return;
 		}
 		// NOLINTNEXTLINE(cppcoreguidelines-slicing)
+		pf.stats.get().record_jump(pos.range_to(neighbor));
+		// NOLINTNEXTLINE(cppcoreguidelines-slicing)
 		g_cost += (n_cost * (pos.range_to(neighbor) - 1)) + pf.look(neighbor);
 	}
 
@@ -0,0 +1,160 @@
+export module screeps:jump_table;
+import :position;
+import std;
+
+namespace screeps {
+
+// JPS+ style jump distances for a room without a cost matrix. For each tile and straight direction
+// this stores how far `jump_x` or `jump_y` would travel before stopping, ignoring the heuristic.
+// Entries are only valid when plain and swamp tiles have different costs.
+export class jump_table_t {
+	public:
+		struct jump_result {
+				int distance;
+				bool dead;
+		};
+
+		explicit jump_table_t(const std::uint8_t* terrain) {
+			constexpr auto wall = 1;
+			const auto terrain_class = [ & ](int xx, int yy) -> int {
+				if (xx < 0 || xx >= 50 || yy < 0 || yy >= 50) {
+					return wall;
+				}
+				auto index = (yy * 50) + xx;
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				auto bits = (unsigned{terrain[ index / 4 ]} >> (index % 4 * 2)) & 0x03;
+				return (bits & 0x01) == 0 ? static_cast<int>(bits) : wall;
+			};
+			for (auto [ direction, dx, dy ] : k_directions) {
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+				auto& table = table_[ direction ];
+				// Perpendicular offset of the tiles checked for forced neighbors
+				auto px = dy == 0 ? 0 : 1;
+				auto py = dx == 0 ? 0 : 1;
+				// Visit tiles so that the next tile in the jump direction has already been filled
+				for (int step = 0; step < 50; ++step) {
+					auto along = dx + dy > 0 ? 49 - step : step;
+					for (int across = 0; across < 50; ++across) {
+						auto xx = dx == 0 ? across : along;
+						auto yy = dx == 0 ? along : across;
+						auto cost = terrain_class(xx, yy);
+						auto entry = std::uint8_t{0};
+						if (cost != wall && !is_near_border_coord(along)) {
+							auto forced =
+								(terrain_class(xx + dx - px, yy + dy - py) != wall && terrain_class(xx - px, yy - py) != cost) ||
+								(terrain_class(xx + dx + px, yy + dy + py) != wall && terrain_class(xx + px, yy + py) != cost);
+							if (!forced) {
+								auto next = terrain_class(xx + dx, yy + dy);
+								if (next == wall) {
+									entry = k_dead;
+								} else if (next != cost) {
+									entry = 1;
+								} else {
+									// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+									entry = static_cast<std::uint8_t>(table[ ((yy + dy) * 50) + xx + dx ] + 1);
+								}
+							}
+						}
+						// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+						table[ (yy * 50) + xx ] = entry;
+					}
+				}
+			}
+		}
+
+		// Returns the distance to the tile where the jump stops. If `dead` is set the jump instead runs
+		// into a wall after `distance` tiles.
+		[[nodiscard]] constexpr auto operator()(unsigned xx, unsigned yy, int dx, int dy) const -> jump_result {
+			auto direction = dx == 0 ? (dy > 0 ? 2 : 3) : (dx > 0 ? 0 : 1);
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			auto entry = table_[ direction ][ (yy * 50) + xx ];
+			return {.distance = entry & ~k_dead, .dead = (entry & k_dead) != 0};
+		}
+
+	private:
+		constexpr static auto k_dead = std::uint8_t{0x80};
+		constexpr static auto k_directions = std::array{
+			std::tuple{0, 1, 0},
+			std::tuple{1, -1, 0},
+			std::tuple{2, 0, 1},
+			std::tuple{3, 0, -1},
+		};
+		std::array<std::array<std::uint8_t, 50 * 50>, 4> table_{};
+};
+
+// Rows and columns of a room's resolved cost grid as bitboards, for straight jumps over tiles of one
+// run cost. This covers rooms with a cost matrix, which have no `jump_table_t`. Bit `ii` of row `yy`
+// is the tile (ii, yy), and bit `ii` of column `xx` is the tile (xx, ii).
+export class jump_bits_t {
+	public:
+		using jump_result = jump_table_t::jump_result;
+
+		auto assign(const room_grid_type& grid, cost_t run_cost) -> void {
+			run_cost_ = run_cost;
+			rows_ = {};
+			columns_ = {};
+			for (unsigned yy = 0; yy < 50; ++yy) {
+				for (unsigned xx = 0; xx < 50; ++xx) {
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+					auto cost = cost_t{grid[ (yy * 50) + xx ]};
+					auto obstacle_bit = std::uint64_t{cost == obstacle};
+					auto differs_bit = std::uint64_t{cost != run_cost};
+					// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+					rows_.obstacle[ yy ] |= obstacle_bit << xx;
+					rows_.differs[ yy ] |= differs_bit << xx;
+					columns_.obstacle[ xx ] |= obstacle_bit << yy;
+					columns_.differs[ xx ] |= differs_bit << yy;
+					// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+				}
+			}
+		}
+
+		// Jumps are only answered for tiles of this cost
+		[[nodiscard]] constexpr auto run_cost() const -> cost_t { return run_cost_; }
+
+		// Same result as `jump_table_t`, for a jump over tiles of `run_cost()`
+		[[nodiscard]] constexpr auto operator()(unsigned xx, unsigned yy, int dx, int dy) const -> jump_result {
+			return dx == 0 ? scan(columns_, yy, xx, dy) : scan(rows_, xx, yy, dx);
+		}
+
+	private:
+		struct lines_type {
+				std::array<std::uint64_t, 50> obstacle;
+				std::array<std::uint64_t, 50> differs;
+		};
+
+		// Stop before moving from any of these, as in `jump_x` and `jump_y`
+		constexpr static auto k_near_border = std::uint64_t{0b11} | (std::uint64_t{0b11} << 48) | (~std::uint64_t{0} << 50);
+
+		// Finds the first tile along a line where the jump stops. `look` wraps lines at room borders,
+		// and so does this.
+		[[nodiscard]] constexpr static auto scan(const lines_type& lines, unsigned along, unsigned across, int step) -> jump_result {
+			// Moves bit `ii + step` to bit `ii`
+			auto ahead = [ & ](std::uint64_t bits) -> std::uint64_t { return step > 0 ? bits >> 1U : bits << 1U; };
+			// NOLINTBEGIN(cppcoreguidelines-pro-bounds-constant-array-index)
+			auto before = (across + 49) % 50;
+			auto after = (across + 1) % 50;
+			auto forced =
+				(ahead(~lines.obstacle[ before ]) & lines.differs[ before ]) |
+				(ahead(~lines.obstacle[ after ]) & lines.differs[ after ]);
+			auto stop = forced | k_near_border;
+			auto changes = ahead(lines.differs[ across ]);
+			auto stops = stop | changes;
+			auto distance = step > 0 ? std::countr_zero(stops >> along) : std::countl_zero(stops << (63 - along));
+			auto at = static_cast<int>(along) + (distance * step);
+			if (((stop >> at) & 1U) != 0) {
+				return {.distance = distance, .dead = false};
+			} else if (((lines.obstacle[ across ] >> (at + step)) & 1U) != 0) {
+				return {.distance = distance, .dead = true};
+			} else {
+				return {.distance = distance + 1, .dead = false};
+			}
+			// NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
+		}
+
+		lines_type rows_{};
+		lines_type columns_{};
+		cost_t run_cost_{};
+};
+
+} // namespace screeps
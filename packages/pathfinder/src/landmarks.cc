@@ -0,0 +1,245 @@
+export module screeps:landmarks;
+import :position;
+import :room;
+import :utility;
+import std;
+
+namespace screeps {
+
+// Number of landmarks picked from the world. Each one costs 2 bytes per tile of loaded terrain.
+constexpr auto k_landmarks = 8;
+
+// Goals with a larger range than this don't get landmark bounds, since every tile in range is
+// scanned when the bounds are made
+export constexpr auto k_max_landmark_range = 24;
+
+constexpr auto k_unreachable = std::uint16_t{0xffff};
+
+// Terrain-only rooms passed to `reset_landmarks`
+export using landmark_rooms_type = std::vector<std::pair<room_location_t, terrain_type>>;
+
+// Unit-cost step counts from a handful of landmark tiles to every tile of the world, considering
+// only terrain walls. By the triangle inequality, `|d(L, a) - d(L, b)|` is a lower bound of the
+// number of moves between `a` and `b`.
+class landmark_table {
+	public:
+		using distances_type = std::array<std::uint16_t, k_landmarks>;
+
+		explicit landmark_table(const landmark_rooms_type& rooms) :
+				rooms_{rooms | std::views::keys | std::ranges::to<std::vector>()},
+				distances_(rooms.size() * 2500) {
+			std::ranges::fill(slots_, 0);
+			for (const auto& [ ii, room ] : std::views::enumerate(rooms_)) {
+				slots_[ std::bit_cast<std::uint16_t>(room) ] = static_cast<std::uint16_t>(ii + 1);
+			}
+		}
+
+		// Returns the distances of each landmark to `pos`, or `nullptr` if the room isn't loaded
+		[[nodiscard]] auto distances(world_position_t pos) const -> const distances_type* {
+			auto node = node_of(pos);
+			return node ? &distances_[ *node ] : nullptr;
+		}
+
+		// Runs a breadth-first search from each landmark. Returns false if `stop` was requested.
+		auto build(const landmark_rooms_type& rooms, const std::stop_token& stop) -> bool {
+			auto walkable = std::vector<bool>(distances_.size());
+			auto unit_costs = terrain_cost_type{{1, obstacle, 1, obstacle}};
+			for (const auto& [ ii, entry ] : std::views::enumerate(rooms)) {
+				auto terrain = room_terrain{entry.second, nullptr};
+				for (unsigned yy = 0; yy < 50; ++yy) {
+					for (unsigned xx = 0; xx < 50; ++xx) {
+						walkable[ (ii * 2500) + (yy * 50) + xx ] = terrain(unit_costs, xx, yy) != obstacle;
+					}
+				}
+			}
+			auto first = std::ranges::find(walkable, true);
+			if (first == walkable.end()) {
+				return true;
+			}
+
+			// Farthest-point selection: the first landmark is the tile farthest from an arbitrary
+			// tile, each next one is farthest from every landmark so far. Tiles which no landmark can
+			// reach are the farthest of all, so disconnected islands each receive one.
+			auto distances = std::vector<std::uint16_t>(distances_.size());
+			auto nearest = std::vector<std::uint16_t>(distances_.size(), k_unreachable);
+			auto next = static_cast<std::size_t>(std::distance(walkable.begin(), first));
+			if (!bfs(next, walkable, distances, stop)) {
+				return false;
+			}
+			next = farthest(walkable, distances);
+			for (int ll = 0; ll < k_landmarks; ++ll) {
+				if (!bfs(next, walkable, distances, stop)) {
+					return false;
+				}
+				for (std::size_t node = 0; node < distances_.size(); ++node) {
+					distances_[ node ][ ll ] = distances[ node ];
+					nearest[ node ] = std::min(nearest[ node ], distances[ node ]);
+				}
+				next = farthest(walkable, nearest);
+			}
+			return true;
+		}
+
+	private:
+		[[nodiscard]] auto node_of(world_position_t pos) const -> std::optional<std::size_t> {
+			if (pos.xx < 0 || pos.yy < 0 || pos.xx >= 256 * 50 || pos.yy >= 256 * 50) {
+				return std::nullopt;
+			}
+			auto slot = slots_[ std::bit_cast<std::uint16_t>(pos.room()) ];
+			if (slot == 0) {
+				return std::nullopt;
+			}
+			return ((slot - 1) * std::size_t{2500}) + (pos.yy % 50 * 50) + (pos.xx % 50);
+		}
+
+		[[nodiscard]] auto pos_of(std::size_t node) const -> world_position_t {
+			auto room = rooms_[ node / 2500 ];
+			auto local = static_cast<int>(node % 2500);
+			return {(room.xx * 50) + (local % 50), (room.yy * 50) + (local / 50)};
+		}
+
+		[[nodiscard]] static auto farthest(const std::vector<bool>& walkable, const std::vector<std::uint16_t>& distances) -> std::size_t {
+			auto result = std::size_t{0};
+			auto best = -1;
+			for (std::size_t node = 0; node < distances.size(); ++node) {
+				if (walkable[ node ] && distances[ node ] > best) {
+					result = node;
+					best = distances[ node ];
+				}
+			}
+			return result;
+		}
+
+		auto bfs(std::size_t source, const std::vector<bool>& walkable, std::vector<std::uint16_t>& distances, const std::stop_token& stop) const -> bool {
+			std::ranges::fill(distances, k_unreachable);
+			auto queue = std::vector<std::size_t>{source};
+			distances[ source ] = 0;
+			for (std::size_t head = 0; head < queue.size(); ++head) {
+				if (head % 4096 == 0 && stop.stop_requested()) {
+					return false;
+				}
+				auto node = queue[ head ];
+				auto pos = pos_of(node);
+				auto distance = static_cast<std::uint16_t>(std::min<int>(distances[ node ] + 1, k_unreachable - 1));
+				for (auto dir : contiguous_enum_range(direction_t::TOP, direction_t::TOP_LEFT)) {
+					auto neighbor = pos.position_in_direction(dir);
+					auto next = node_of(neighbor);
+					if (next && walkable[ *next ] && distances[ *next ] == k_unreachable && is_possible_move(pos, neighbor)) {
+						distances[ *next ] = distance;
+						queue.push_back(*next);
+					}
+				}
+			}
+			return true;
+		}
+
+		std::array<std::uint16_t, 1 << 16> slots_{};
+		std::vector<room_location_t> rooms_;
+		std::vector<distances_type> distances_;
+};
+
+// Rooms of the next table, if terrain changed since the last build started, the most recently
+// completed table, and the thread building the next one. Builds are numbered so that a stopped
+// build which completes late never replaces a newer table.
+std::mutex landmark_lock;
+std::optional<landmark_rooms_type> landmark_rooms;
+std::shared_ptr<const landmark_table> landmark_snapshot;
+std::uint64_t landmark_snapshot_build{};
+std::uint64_t landmark_builds{};
+std::jthread landmark_builder;
+
+// Replaces the rooms which landmark distances span. The table is rebuilt once a search asks for it.
+export auto reset_landmarks(landmark_rooms_type rooms) -> void {
+	std::lock_guard lock{landmark_lock};
+	landmark_rooms = std::move(rooms);
+}
+
+// Rebuilds landmark distances in the background. Searches keep using the previous table, if any,
+// until the new one is done.
+auto build_landmarks(landmark_rooms_type rooms, std::uint64_t build) -> void {
+	auto builder = std::jthread{[ rooms = std::move(rooms), build ](const std::stop_token& stop) {
+		auto table = std::make_shared<landmark_table>(rooms);
+		if (table->build(rooms, stop)) {
+			std::lock_guard lock{landmark_lock};
+			if (build > landmark_snapshot_build) {
+				landmark_snapshot = std::move(table);
+				landmark_snapshot_build = build;
+			}
+		}
+	}};
+	auto previous = std::jthread{};
+	{
+		std::lock_guard lock{landmark_lock};
+		previous = std::exchange(landmark_builder, std::move(builder));
+	}
+	// The previous builder is stopped and joined here, outside of the lock, since it takes the lock
+	// to publish
+}
+
+// Returns the completed table, or `nullptr` while the first one is still being built. The first
+// call after terrain is loaded starts the build, so processes which never run a landmark search
+// never build the table.
+export auto landmarks() -> std::shared_ptr<const landmark_table> {
+	auto rooms = std::optional<landmark_rooms_type>{};
+	auto build = std::uint64_t{};
+	{
+		std::lock_guard lock{landmark_lock};
+		if (!landmark_rooms) {
+			return landmark_snapshot;
+		}
+		rooms = std::exchange(landmark_rooms, std::nullopt);
+		build = ++landmark_builds;
+	}
+	build_landmarks(*std::move(rooms), build);
+	std::lock_guard lock{landmark_lock};
+	return landmark_snapshot;
+}
+
+// Lower bound of the number of moves from a tile to any tile within range of a goal, ignoring
+// cost matrices. Per landmark this keeps the closest and farthest goal tiles.
+export class landmark_bounds {
+	public:
+		landmark_bounds(std::shared_ptr<const landmark_table> table, world_position_t goal, int range) :
+				table_{std::move(table)} {
+			lo_.fill(k_unreachable);
+			hi_.fill(0);
+			for (int dy = -range; dy <= range; ++dy) {
+				for (int dx = -range; dx <= range; ++dx) {
+					const auto* distances = table_->distances({goal.xx + dx, goal.yy + dy});
+					if (distances == nullptr) {
+						continue;
+					}
+					for (int ll = 0; ll < k_landmarks; ++ll) {
+						auto distance = (*distances)[ ll ];
+						if (distance != k_unreachable) {
+							lo_[ ll ] = std::min(lo_[ ll ], distance);
+							hi_[ ll ] = std::max(hi_[ ll ], distance);
+						}
+					}
+				}
+			}
+		}
+
+		[[nodiscard]] auto operator()(world_position_t pos) const -> cost_t {
+			const auto* distances = table_->distances(pos);
+			if (distances == nullptr) {
+				return 0;
+			}
+			auto bound = 0;
+			for (int ll = 0; ll < k_landmarks; ++ll) {
+				// Landmarks in another island than `pos` or the goal say nothing
+				int distance = (*distances)[ ll ];
+				if (distance != k_unreachable && lo_[ ll ] != k_unreachable) {
+					bound = std::max({bound, distance - hi_[ ll ], lo_[ ll ] - distance});
+				}
+			}
+			return bound;
+		}
+
+	private:
+		std::shared_ptr<const landmark_table> table_;
+		std::array<std::uint16_t, k_landmarks> lo_{};
+		std::array<std::uint16_t, k_landmarks> hi_{};
+};
+
+} // namespace screeps
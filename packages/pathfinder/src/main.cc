@@ -16,17 +16,36 @@ import v8_js;
 using namespace screeps;
 namespace iv8 = js::iv8;
 
-constexpr auto k_max_rooms = 64;
-
 // Invoke the user `roomCallback` and adapt for the pathfinder
 class room_callback_type {
 	public:
 		room_callback_type() = default;
-		explicit room_callback_type(iv8::context_lock_witness& lock, v8::Local<iv8::Function> maybe_room_callback) :
+		explicit room_callback_type(iv8::context_lock_witness& lock, v8::Local<iv8::Function> maybe_room_callback, room_callback_cache* cache = nullptr) :
 				lock_{&lock},
-				maybe_room_callback{maybe_room_callback} {}
+				maybe_room_callback{maybe_room_callback},
+				cache_{cache} {}
 
 		auto operator()(room_location_t room) -> room_callback_result_type {
+			if (cache_ == nullptr) {
+				return invoke(room);
+			} else {
+				return (*cache_)(room, [ this ](room_location_t location) -> room_callback_result_type { return invoke(location); });
+			}
+		}
+
+		// What a search would see of `room`, for `path_cache`. Rooms resolved from preloaded or stored
+		// matrices don't invoke the room callback.
+		auto state(room_location_t room) -> room_state {
+			if (cache_ == nullptr) {
+				return room_state{invoke(room)};
+			} else {
+				(*this)(room);
+				return cache_->state(room);
+			}
+		}
+
+	private:
+		auto invoke(room_location_t room) -> room_callback_result_type {
 			if (maybe_room_callback.IsEmpty()) {
 				return std::monostate{};
 			} else {
@@ -34,9 +53,9 @@ class room_callback_type {
 			}
 		}
 
-	private:
 		iv8::context_lock_witness* lock_{};
 		v8::Local<iv8::Function> maybe_room_callback;
+		room_callback_cache* cache_{};
 };
 
 // Invoked once per operation
@@ -46,14 +65,40 @@ auto check_termination() -> void {
 	}
 }
 
-// Each thread gets two pathfinders. The first can search 64 rooms and is 2.03mb, and the second can
-// only search room but is 159kb. A recursive call will give you the smaller pathfinder, and then
-// any after that will throw.
+// Each thread gets two pathfinders. The first can search 256 rooms and the second can only search one
+// room. Node state is reserved address space, so each only takes memory for the rooms its searches
+// have actually opened. A recursive call will give you the smaller pathfinder, and then
+// any after that will throw. Bidirectional searches allocate a second frontier of the same size the
+// first time they are used.
 using pathfinder_one_type = pathfinder<check_termination, room_callback_type, k_max_rooms>;
 using pathfinder_two_type = pathfinder<check_termination, room_callback_type, 1>;
 using pathfinder_stack_type = resource_recursion_stack<pathfinder_one_type, pathfinder_two_type>;
 thread_local pathfinder_stack_type pathfinders;
 
+// Searches started by `startSearch` each own a 256 room node state, like `pathfinder_one_type`
+using search_session_type = search_session<check_termination, room_callback_type, k_max_rooms>;
+
+auto search_sessions() -> handle_registry<search_session_type>& {
+	static handle_registry<search_session_type> registry;
+	return registry;
+}
+
+// Results which are known before `room_callback` is invoked: preloaded matrices, and then those kept
+// in a matrix store. Returns false if there are none.
+auto preload(room_callback_cache& cache, const std::optional<std::vector<room_matrix>>& matrices, std::optional<stored_matrices> stored) -> bool {
+	if (matrices) {
+		cache.preload(*matrices);
+	}
+	if (stored) {
+		auto store = matrix_stores().find(v8::Isolate::GetCurrent(), stored->store);
+		if (!store) {
+			throw js::runtime_error{u"invalid matrix store handle"};
+		}
+		cache.attach(std::move(store), stored->variant);
+	}
+	return matrices || stored;
+}
+
 auto search(
 	iv8::context_lock_witness lock,
 	world_position_t origin,
@@ -66,16 +111,25 @@ auto search(
 	int max_ops,
 	int max_cost,
 	bool flee,
-	double heuristic_weight
+	double heuristic_weight,
+	bool bidirectional,
+	bool hierarchical,
+	bool landmarks,
+	int max_time,
+	int check_interval,
+	std::optional<std::vector<room_matrix>> matrices,
+	std::optional<stored_matrices> stored
 ) -> std::optional<result> {
 	auto [ heuristic, storage ] = heuristic_t::make_from_runtime(lock, goals, flee);
+	auto preloaded = room_callback_cache{};
+	auto has_preloaded = preload(preloaded, matrices, stored);
 	return pathfinders(
 		util::overloaded{
 			[]() -> std::optional<result> { throw js::runtime_error{u"too many concurrent pathfinder searches"}; },
 			[ & ](auto& pf) -> std::optional<result> {
 				// Get the values from v8 and run the search
 				return pf.search(
-					room_callback_type{lock, *room_callback.value_or({})},
+					room_callback_type{lock, *room_callback.value_or({}), has_preloaded ? &preloaded : nullptr},
 					origin,
 					heuristic,
 					{
@@ -85,6 +139,12 @@ auto search(
 						.max_cost = max_cost,
 						.max_ops = max_ops,
 						.max_rooms = max_rooms,
+						.max_time = max_time,
+						.check_interval = check_interval,
+						.bidirectional = bidirectional,
+						.hierarchical = hierarchical,
+						.landmarks = landmarks,
+						.terrain_only = !room_callback && !has_preloaded,
 					}
 				);
 			},
@@ -92,6 +152,271 @@ auto search(
 	);
 }
 
+// Same as `search`, but repeated queries are answered from this thread's `path_cache` while the
+// room callback returns the same results
+auto search_cached(
+	iv8::context_lock_witness lock,
+	int time,
+	world_position_t origin,
+	iv8::value_of<js::list_tag> goals,
+	std::optional<js::forward<v8::Local<iv8::Function>>> room_callback,
+	// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+	int plain_cost,
+	int swamp_cost,
+	int max_rooms,
+	int max_ops,
+	int max_cost,
+	bool flee,
+	double heuristic_weight,
+	bool bidirectional,
+	bool hierarchical,
+	bool landmarks,
+	int max_time,
+	int check_interval,
+	std::optional<std::vector<room_matrix>> matrices,
+	std::optional<stored_matrices> stored
+) -> std::optional<batch_result> {
+	auto [ heuristic, storage ] = heuristic_t::make_from_runtime(lock, goals, flee);
+	auto preloaded = room_callback_cache{};
+	auto has_preloaded = preload(preloaded, matrices, stored);
+	auto validate = room_callback_type{lock, *room_callback.value_or({}), has_preloaded ? &preloaded : nullptr};
+	return thread_path_cache()(
+		time,
+		validate,
+		origin,
+		heuristic,
+		{
+			.heuristic_weight = heuristic_weight,
+			.plain_cost = plain_cost,
+			.swamp_cost = swamp_cost,
+			.max_cost = max_cost,
+			.max_ops = max_ops,
+			.max_rooms = max_rooms,
+			.max_time = max_time,
+			.check_interval = check_interval,
+			.bidirectional = bidirectional,
+			.hierarchical = hierarchical,
+			.landmarks = landmarks,
+			.terrain_only = !room_callback && !has_preloaded,
+		},
+		[ & ](room_callback_cache& resolved, const auto& options) -> std::optional<result> {
+			preload(resolved, matrices, stored);
+			return pathfinders(
+				util::overloaded{
+					[]() -> std::optional<result> { throw js::runtime_error{u"too many concurrent pathfinder searches"}; },
+					[ & ](auto& pf) -> std::optional<result> {
+						return pf.search(room_callback_type{lock, *room_callback.value_or({}), &resolved}, origin, heuristic, options);
+					},
+				}
+			);
+		}
+	);
+}
+
+// Same as `search`, or `search_cached` if `time` is given, but the path is expanded tile by tile
+// into `positions` and `directions` instead of being returned as an array of jump points. `time`
+// is ignored unless `Cached` is set, which it isn't for sandboxes.
+template <bool Cached>
+auto search_packed(
+	iv8::context_lock_witness lock,
+	std::optional<int> time,
+	world_position_t origin,
+	iv8::value_of<js::list_tag> goals,
+	std::optional<js::forward<v8::Local<iv8::Function>>> room_callback,
+	// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+	int plain_cost,
+	int swamp_cost,
+	int max_rooms,
+	int max_ops,
+	int max_cost,
+	bool flee,
+	double heuristic_weight,
+	bool bidirectional,
+	bool hierarchical,
+	bool landmarks,
+	int max_time,
+	int check_interval,
+	std::optional<std::vector<room_matrix>> matrices,
+	std::optional<stored_matrices> stored,
+	std::span<std::int32_t> positions,
+	std::optional<std::span<std::uint8_t>> directions
+) -> std::optional<packed_result> {
+	auto pack = [ & ](const auto& result) -> std::optional<packed_result> {
+		if (!result) {
+			return std::nullopt;
+		}
+		return packed_result{
+			.cost = result->cost,
+			.length = write_path(result->path, positions, directions.value_or(std::span<std::uint8_t>{})),
+			.ops = result->ops,
+			.incomplete = result->incomplete,
+		};
+	};
+	if (Cached && time) {
+		return pack(search_cached(lock, *time, origin, goals, std::move(room_callback), plain_cost, swamp_cost, max_rooms, max_ops, max_cost, flee, heuristic_weight, bidirectional, hierarchical, landmarks, max_time, check_interval, std::move(matrices), stored));
+	} else {
+		return pack(search(lock, origin, goals, std::move(room_callback), plain_cost, swamp_cost, max_rooms, max_ops, max_cost, flee, heuristic_weight, bidirectional, hierarchical, landmarks, max_time, check_interval, std::move(matrices), stored));
+	}
+}
+
+auto search_many(
+	iv8::context_lock_witness lock,
+	std::vector<batch_query> queries,
+	std::optional<js::forward<v8::Local<iv8::Function>>> room_callback
+) -> std::vector<batch_result> {
+	return pathfinders(
+		util::overloaded{
+			[]() -> std::vector<batch_result> { throw js::runtime_error{u"too many concurrent pathfinder searches"}; },
+			[ & ](auto& pf) -> std::vector<batch_result> {
+				// Rooms are resolved once for the whole batch
+				auto cache = room_callback_cache{};
+				return pf.search_many(room_callback_type{lock, *room_callback.value_or({}), &cache}, queries);
+			},
+		}
+	);
+}
+
+auto distance_field(
+	iv8::context_lock_witness lock,
+	iv8::value_of<js::list_tag> goals,
+	std::optional<js::forward<v8::Local<iv8::Function>>> room_callback,
+	// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+	int plain_cost,
+	int swamp_cost,
+	int max_rooms,
+	int max_ops,
+	int max_cost,
+	std::span<std::uint16_t> distances,
+	std::span<std::uint8_t> directions
+) -> std::vector<room_location_t> {
+	auto [ heuristic, storage ] = heuristic_t::make_from_runtime(lock, goals, false);
+	return pathfinders(
+		util::overloaded{
+			[]() -> std::vector<room_location_t> { throw js::runtime_error{u"too many concurrent pathfinder searches"}; },
+			[ & ](auto& pf) -> std::vector<room_location_t> {
+				return pf.distance_field(
+					room_callback_type{lock, *room_callback.value_or({})},
+					heuristic,
+					{
+						.plain_cost = plain_cost,
+						.swamp_cost = swamp_cost,
+						.max_cost = max_cost,
+						.max_ops = max_ops,
+						.max_rooms = max_rooms,
+					},
+					distances,
+					directions
+				);
+			},
+		}
+	);
+}
+
+// Planners are owned by the isolate which created them
+auto create_planner(
+	world_position_t origin,
+	std::vector<heuristic_t::goal_t> goals,
+	// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+	int plain_cost,
+	int swamp_cost,
+	int max_rooms
+) -> int {
+	auto planner = std::make_shared<screeps::planner>(origin, std::move(goals), plain_cost, swamp_cost, max_rooms);
+	return planners().insert(v8::Isolate::GetCurrent(), std::move(planner));
+}
+
+auto update_planner(
+	iv8::context_lock_witness lock,
+	int handle,
+	world_position_t origin,
+	std::vector<tile_change> changes,
+	std::optional<js::forward<v8::Local<iv8::Function>>> room_callback,
+	int max_ops
+) -> batch_result {
+	auto planner = planners().find(v8::Isolate::GetCurrent(), handle);
+	if (!planner) {
+		throw js::runtime_error{u"invalid planner handle"};
+	} else if (planner->updating()) {
+		throw js::runtime_error{u"planner is already updating"};
+	}
+	auto callback = room_callback_type{lock, *room_callback.value_or({})};
+	return planner->update<check_termination>(callback, origin, changes, max_ops);
+}
+
+auto free_planner(int handle) -> void {
+	planners().erase(v8::Isolate::GetCurrent(), handle);
+}
+
+// Resumable searches are owned by the isolate which started them
+auto start_search(batch_query query) -> int {
+	auto session = std::make_shared<search_session_type>(query.origin, std::move(query.goals), query.flee, query.search_options);
+	return search_sessions().insert(v8::Isolate::GetCurrent(), std::move(session));
+}
+
+auto resume_search(
+	iv8::context_lock_witness lock,
+	int handle,
+	std::optional<js::forward<v8::Local<iv8::Function>>> room_callback,
+	int max_ops
+) -> search_progress {
+	auto session = search_sessions().find(v8::Isolate::GetCurrent(), handle);
+	if (!session) {
+		throw js::runtime_error{u"invalid search handle"};
+	} else if (session->running()) {
+		throw js::runtime_error{u"search is already running"};
+	}
+	return session->resume(room_callback_type{lock, *room_callback.value_or({}), &session->rooms()}, max_ops);
+}
+
+auto free_search(int handle) -> void {
+	search_sessions().erase(v8::Isolate::GetCurrent(), handle);
+}
+
+// Matrix stores are owned by the isolate which created them
+auto create_matrix_store() -> int {
+	return matrix_stores().insert(v8::Isolate::GetCurrent(), std::make_shared<matrix_store>());
+}
+
+auto find_matrix_store(int handle) -> std::shared_ptr<matrix_store> {
+	auto store = matrix_stores().find(v8::Isolate::GetCurrent(), handle);
+	if (!store) {
+		throw js::runtime_error{u"invalid matrix store handle"};
+	}
+	return store;
+}
+
+// Replaces the matrices of each listed room. Matrices are copied, and a room without one is blocked.
+auto set_cost_matrices(int handle, int variant, std::vector<room_matrix> matrices) -> void {
+	auto store = find_matrix_store(handle);
+	if (std::ranges::any_of(matrices, [](const room_matrix& entry) -> bool { return entry.matrix && entry.matrix->size() != 2'500; })) {
+		throw js::runtime_error{u"cost matrix must be 2500 bytes"};
+	}
+	for (const auto& entry : matrices) {
+		store->set(variant, entry.room, entry.matrix.transform([](auto matrix) -> auto { return matrix.template first<2'500>(); }));
+	}
+}
+
+auto patch_cost_matrices(int handle, int variant, std::vector<tile_change> changes) -> void {
+	find_matrix_store(handle)->patch(variant, changes);
+}
+
+auto clear_cost_matrices(int handle, std::optional<int> variant) -> void {
+	find_matrix_store(handle)->clear(variant);
+}
+
+// Versions are only ever compared, so the precision of a double is plenty
+auto cost_matrix_version(int handle, int variant, room_location_t room) -> std::optional<double> {
+	auto stored = find_matrix_store(handle)->find(variant, room);
+	if (!stored) {
+		return std::nullopt;
+	}
+	return static_cast<double>(stored->version);
+}
+
+auto free_matrix_store(int handle) -> void {
+	matrix_stores().erase(v8::Isolate::GetCurrent(), handle);
+}
+
 EXPORT ISOLATED_VM_MODULE void InitForContext(v8::Isolate* isolate, v8::Local<v8::Context> context, v8::Local<v8::Object> target) {
 	auto isolate_witness = js::iv8::isolate_lock_witness::make_witness(isolate);
 	auto context_witness = js::iv8::context_lock_witness::make_witness(isolate_witness, context);
@@ -100,8 +425,14 @@ EXPORT ISOLATED_VM_MODULE void InitForContext(v8::Isolate* isolate, v8::Local<v8
 		target,
 		std::tuple{
 			std::pair{util::cw<"search">, js::free_function{search}},
+			std::pair{util::cw<"searchMany">, js::free_function{search_many}},
+			std::pair{util::cw<"searchPacked">, js::free_function{search_packed<false>}},
+			std::pair{util::cw<"distanceField">, js::free_function{distance_field}},
+			std::pair{util::cw<"findRoute">, js::free_function{find_route}},
 			std::pair{util::cw<"loadTerrain">, js::free_function{load_terrain}},
-			std::pair{util::cw<"version">, 12},
+			std::pair{util::cw<"searchStats">, js::free_function{last_search_stats}},
+			std::pair{util::cw<"maxRooms">, static_cast<int>(k_max_rooms)},
+			std::pair{util::cw<"version">, 29},
 		}
 	);
 }
@@ -109,6 +440,39 @@ EXPORT ISOLATED_VM_MODULE void InitForContext(v8::Isolate* isolate, v8::Local<v8
 void init(v8::Local<v8::Object> target) {
 	v8::Isolate* isolate = v8::Isolate::GetCurrent();
 	InitForContext(isolate, isolate->GetCurrentContext(), target);
+	// Worker threads, process-wide settings, file access, the path cache and native objects kept by
+	// handle are offered to nodejs only, not to sandboxes. Handles are only freed by their owner, so a
+	// sandbox could otherwise hold on to any amount of native memory. The path cache is shared by
+	// every sandbox on a thread, so a cache hit would tell one player what another searched.
+	// `searchPacked` is replaced with a version which uses the path cache.
+	auto isolate_witness = js::iv8::isolate_lock_witness::make_witness(isolate);
+	auto context_witness = js::iv8::context_lock_witness::make_witness(isolate_witness, isolate->GetCurrentContext());
+	js::iv8::object_assign(
+		context_witness,
+		target,
+		std::tuple{
+			std::pair{util::cw<"clearCostMatrices">, js::free_function{clear_cost_matrices}},
+			std::pair{util::cw<"configureParallelSearch">, js::free_function{configure_parallel_search}},
+			std::pair{util::cw<"configurePathCache">, js::free_function{configure_path_cache}},
+			std::pair{util::cw<"costMatrixVersion">, js::free_function{cost_matrix_version}},
+			std::pair{util::cw<"createMatrixStore">, js::free_function{create_matrix_store}},
+			std::pair{util::cw<"createPlanner">, js::free_function{create_planner}},
+			std::pair{util::cw<"freeMatrixStore">, js::free_function{free_matrix_store}},
+			std::pair{util::cw<"freePlanner">, js::free_function{free_planner}},
+			std::pair{util::cw<"freeSearch">, js::free_function{free_search}},
+			std::pair{util::cw<"loadTerrainFile">, js::free_function{load_terrain_file}},
+			std::pair{util::cw<"patchCostMatrices">, js::free_function{patch_cost_matrices}},
+			std::pair{util::cw<"resumeSearch">, js::free_function{resume_search}},
+			std::pair{util::cw<"saveTerrainFile">, js::free_function{save_terrain_file}},
+			std::pair{util::cw<"searchCached">, js::free_function{search_cached}},
+			std::pair{util::cw<"searchPacked">, js::free_function{search_packed<true>}},
+			std::pair{util::cw<"searchParallel">, js::free_function{search_parallel}},
+			std::pair{util::cw<"setCostMatrices">, js::free_function{set_cost_matrices}},
+			std::pair{util::cw<"startSearch">, js::free_function{start_search}},
+			std::pair{util::cw<"stats">, js::free_function{process_stats}},
+			std::pair{util::cw<"updatePlanner">, js::free_function{update_planner}},
+		}
+	);
 }
 
 #pragma clang diagnostic push
@@ -0,0 +1,124 @@
+export module screeps:matrix_store;
+import :position;
+import :room;
+import :utility;
+import auto_js;
+import std;
+import util;
+
+namespace screeps {
+
+// One changed tile for `planner::update` or `matrix_store::patch`, using `CostMatrix` values. 0
+// restores the terrain cost and 255 is an obstacle.
+export struct tile_change {
+		world_position_t pos;
+		int cost{};
+
+		constexpr static auto struct_template = js::struct_template{
+			js::struct_member{util::cw<"cost">, &tile_change::cost},
+			js::struct_member{util::cw<"pos">, &tile_change::pos},
+		};
+};
+
+// Matrix store and variant read by a search
+export struct stored_matrices {
+		int store{};
+		int variant{};
+
+		constexpr static auto struct_template = js::struct_template{
+			js::struct_member{util::cw<"store">, &stored_matrices::store},
+			js::struct_member{util::cw<"variant">, &stored_matrices::variant},
+		};
+};
+
+// Versions are unique across every store, so that a version alone identifies the contents of a
+// matrix
+std::atomic<std::uint64_t> last_matrix_version;
+
+// Cost matrix owned by a `matrix_store`. A stored matrix is never changed, updates publish a new
+// one, so a search may keep reading it while the store is updated from a room callback.
+export struct stored_matrix {
+		// `std::nullopt` blocks the room
+		std::optional<std::array<std::uint8_t, 2'500>> costs;
+		std::uint64_t version{};
+};
+
+// Cost matrices which are kept natively between searches and ticks. Matrices are keyed by room and
+// by a variant number chosen by the caller, for example one per set of matrix options.
+export class matrix_store {
+	public:
+		using costs_type = std::optional<std::array<std::uint8_t, 2'500>>;
+		using entry_type = std::shared_ptr<const stored_matrix>;
+
+		// Returns the matrix of `room`, or `nullptr` if it has none
+		[[nodiscard]] auto find(int variant, room_location_t room) const -> entry_type {
+			auto entry = entries_.find(key_of(variant, room));
+			return entry == entries_.end() ? nullptr : entry->second;
+		}
+
+		// Replaces the matrix of `room`. `std::nullopt` blocks the room.
+		auto set(int variant, room_location_t room, std::optional<std::span<const std::uint8_t, 2'500>> matrix) -> void {
+			auto costs = costs_type{};
+			if (matrix) {
+				std::ranges::copy(*matrix, costs.emplace().begin());
+			}
+			publish(key_of(variant, room), std::move(costs));
+		}
+
+		// Applies each change to the matrix of its room. Rooms without a matrix, or which are blocked,
+		// start from terrain costs.
+		auto patch(int variant, std::span<const tile_change> changes) -> void {
+			auto patched = std::unordered_map<room_location_t, std::array<std::uint8_t, 2'500>, room_location_t::hash>{};
+			for (const auto& change : changes) {
+				auto room = change.pos.room();
+				auto [ entry, inserted ] = patched.try_emplace(room);
+				if (inserted) {
+					auto previous = find(variant, room);
+					if (previous && previous->costs) {
+						entry->second = *previous->costs;
+					}
+				}
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+				entry->second[ (change.pos.xx % 50 * 50) + (change.pos.yy % 50) ] = static_cast<std::uint8_t>(std::clamp(change.cost, 0, 0xff));
+			}
+			for (const auto& [ room, costs ] : patched) {
+				publish(key_of(variant, room), costs);
+			}
+		}
+
+		// Removes every matrix of `variant`, or of every variant
+		auto clear(std::optional<int> variant) -> void {
+			if (variant) {
+				std::erase_if(entries_, [ & ](const auto& entry) -> bool { return entry.first >> 16 == static_cast<std::uint32_t>(*variant); });
+			} else {
+				entries_.clear();
+			}
+		}
+
+	private:
+		using key_type = std::uint64_t;
+
+		static auto key_of(int variant, room_location_t room) -> key_type {
+			return (key_type{static_cast<std::uint32_t>(variant)} << 16) | std::bit_cast<std::uint16_t>(room);
+		}
+
+		// A matrix which is set to the same contents keeps its version, so searches cached against it
+		// remain valid
+		auto publish(key_type key, costs_type costs) -> void {
+			auto& entry = entries_[ key ];
+			if (entry && entry->costs == costs) {
+				return;
+			}
+			entry = std::make_shared<const stored_matrix>(stored_matrix{.costs = std::move(costs), .version = ++last_matrix_version});
+		}
+
+		std::unordered_map<key_type, entry_type> entries_;
+};
+
+// Stores outlive the call that made them, so they are kept here and referred to by handle
+export auto matrix_stores() -> handle_registry<matrix_store>& {
+	static handle_registry<matrix_store> registry;
+	return registry;
+}
+
+} // namespace screeps
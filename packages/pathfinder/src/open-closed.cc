@@ -1,32 +1,50 @@
 module;
 #include <cassert>
 export module screeps:open_closed;
+import :utility;
 import std;
 
 namespace screeps {
 
-// Type-erased view over `open_closed_t`
-class open_closed_view {
+// Type-erased view over `open_closed_t`, or over the markers of interleaved node records which are
+// `Stride` bytes apart
+template <std::size_t Stride = sizeof(unsigned)>
+class basic_open_closed_view {
 	public:
 		using value_type = unsigned;
+		using list_type = strided_pointer<value_type, Stride>;
 
-		open_closed_view() = delete;
-		explicit constexpr open_closed_view(value_type* list, value_type marker) :
+		basic_open_closed_view() = delete;
+		explicit constexpr basic_open_closed_view(list_type list, value_type marker) :
 				list_{list},
 				marker_{marker} {}
 
-		[[nodiscard]] constexpr auto is_closed(std::size_t index) const -> bool { return at(index) == marker_ + 1; }
-		[[nodiscard]] constexpr auto is_open(std::size_t index) const -> bool { return at(index) == marker_; }
-		constexpr auto close(std::size_t index) -> void { at(index) = marker_ + 1; }
-		constexpr auto open(std::size_t index) -> void { at(index) = marker_; }
+		[[nodiscard]] constexpr auto is_closed(std::size_t index) const -> bool { return list_[ index ] == marker_ + 1; }
+		[[nodiscard]] constexpr auto is_open(std::size_t index) const -> bool { return list_[ index ] == marker_; }
+		constexpr auto close(std::size_t index) -> void { list_[ index ] = marker_ + 1; }
+		constexpr auto open(std::size_t index) -> void { list_[ index ] = marker_; }
 
 	private:
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-		[[nodiscard]] constexpr auto at(std::size_t index) const -> value_type& { return list_[ index ]; }
-
-		value_type* list_{};
+		list_type list_;
 		value_type marker_{};
 };
+using open_closed_view = basic_open_closed_view<>;
+
+// Allocates the next marker pair over `list`. The list is reset when markers run out.
+template <std::size_t Stride>
+constexpr auto next_open_closed_view(strided_pointer<unsigned, Stride> list, std::size_t size, unsigned& marker) -> basic_open_closed_view<Stride> {
+	constexpr auto k_width = 2U;
+	auto view = basic_open_closed_view<Stride>{list, marker};
+	if (std::numeric_limits<unsigned>::max() - k_width <= marker) {
+		for (std::size_t ii = 0; ii < size; ++ii) {
+			list[ ii ] = 0;
+		}
+		marker = 1;
+	} else {
+		marker += k_width;
+	}
+	return view;
+}
 
 // Simple open-closed list. Marker pairs are allocated to `open_closed_view` instances, which
 // perform the actual list operations.
@@ -36,18 +54,10 @@ class open_closed_t {
 		using value_type = open_closed_view::value_type;
 
 		constexpr auto clear_and_make_view() -> open_closed_view {
-			auto view = open_closed_view{list_.data(), marker_};
-			if (std::numeric_limits<value_type>::max() - k_width <= marker_) {
-				std::ranges::fill(list_, 0);
-				marker_ = 1;
-			} else {
-				marker_ += k_width;
-			}
-			return view;
+			return next_open_closed_view(open_closed_view::list_type{list_.data()}, list_.size(), marker_);
 		}
 
 	private:
-		constexpr static auto k_width = 2;
 		std::array<value_type, Capacity> list_{};
 		value_type marker_ = 1;
 };
@@ -0,0 +1,192 @@
+export module screeps:path_cache;
+import :pf;
+import std;
+
+namespace screeps {
+
+// Cache limits, shared by every thread
+std::atomic<std::size_t> path_cache_max_bytes = 1 << 20;
+std::atomic<int> path_cache_max_age = 50;
+
+// LRU cache of completed searches. An entry is returned only if the room callback still gives the
+// same result for every room the original search resolved, compared by matrix contents or by
+// matrix store version. Terrain does not change at runtime, so together with the query this
+// determines the path.
+export class path_cache {
+	private:
+		struct key_type {
+				constexpr auto operator==(const key_type& right) const -> bool = default;
+
+				world_position_t origin;
+				std::vector<heuristic_t::goal_t> goals;
+				bool flee{};
+				options search_options;
+		};
+
+		struct key_hash {
+				auto operator()(const key_type& key) const -> std::size_t {
+					auto hash = std::size_t{0};
+					auto mix = [ & ](auto value) -> void {
+						hash ^= std::hash<decltype(value)>{}(value) + 0x9e37'79b9 + (hash << 6) + (hash >> 2);
+					};
+					mix(key.origin.xx);
+					mix(key.origin.yy);
+					for (const auto& goal : key.goals) {
+						mix(goal.pos.xx);
+						mix(goal.pos.yy);
+						mix(goal.range);
+					}
+					mix(key.flee);
+					const auto& options = key.search_options;
+					mix(options.heuristic_weight);
+					mix(options.plain_cost);
+					mix(options.swamp_cost);
+					mix(options.max_cost);
+					mix(options.max_ops);
+					mix(options.max_rooms);
+					mix(options.bidirectional);
+					mix(options.hierarchical);
+					mix(options.landmarks);
+					return hash;
+				}
+		};
+
+		struct entry_type {
+				key_type key;
+				batch_result result;
+				std::vector<std::pair<room_location_t, room_state>> rooms;
+				std::size_t bytes{};
+				int time{};
+		};
+
+		using entries_type = std::list<entry_type>;
+
+	public:
+		// Returns the cached result of the query, or invokes `search` with a `room_callback_cache` which
+		// must be passed along to the search's room callback. `room_callback` is used to check that a
+		// cached result is still valid. `time` is the current game tick.
+		template <class Callback, class Search>
+		auto operator()(
+			int time,
+			Callback& room_callback,
+			world_position_t origin,
+			const heuristic_t& heuristic,
+			const options& options,
+			Search search
+		) -> std::optional<batch_result> {
+			tick(time);
+			auto goals = heuristic.goals();
+			auto key = key_type{
+				.origin = origin,
+				.goals = {goals.begin(), goals.end()},
+				.flee = heuristic.flee(),
+				.search_options = options,
+			};
+
+			// Check for a cached result. The room callback may run another cached search, so the entry is
+			// looked up again afterward.
+			if (auto found = index_.find(key); found != index_.end()) {
+				auto rooms = found->second->rooms;
+				auto valid = std::ranges::all_of(rooms, [ & ](const auto& room) -> bool {
+					return room_callback.state(room.first) == room.second;
+				});
+				found = index_.find(key);
+				if (found != index_.end() && found->second->rooms == rooms) {
+					auto entry = found->second;
+					if (valid) {
+						entry->time = time_;
+						entries_.splice(entries_.begin(), entries_, entry);
+						// No nodes were expanded for this result
+						auto result = entry->result;
+						result.ops = 0;
+						return result;
+					}
+					erase(entry);
+				}
+			}
+
+			// Run the search and save the rooms it resolved
+			auto resolved = room_callback_cache{};
+			auto search_result = search(resolved, options);
+			if (!search_result) {
+				return std::nullopt;
+			}
+			auto entry = entry_type{.key = std::move(key), .time = time_};
+			std::ranges::copy(search_result->path, std::back_inserter(entry.result.path));
+			entry.result.cost = search_result->cost;
+			entry.result.ops = search_result->ops;
+			entry.result.incomplete = search_result->incomplete;
+			for (const auto& room : resolved.results() | std::views::keys) {
+				entry.rooms.emplace_back(room, resolved.state(room).owned());
+			}
+			entry.bytes =
+				sizeof(entry_type) + sizeof(key_type) +
+				(entry.key.goals.size() * sizeof(heuristic_t::goal_t) * 2) +
+				(entry.result.path.size() * sizeof(world_position_t)) +
+				std::ranges::fold_left(entry.rooms | std::views::values | std::views::transform(&room_state::bytes), std::size_t{0}, std::plus{});
+			auto result = entry.result;
+			// Where a search runs out of time depends on the load of the machine, not on the query
+			if (!search_result->timed_out) {
+				insert(std::move(entry));
+			}
+			return result;
+		}
+
+	private:
+		// Drops entries which have not been used within `max_age` ticks. Everything is dropped if time
+		// goes backward, which happens when a new world is loaded.
+		auto tick(int time) -> void {
+			if (time < time_) {
+				entries_.clear();
+				index_.clear();
+				bytes_ = 0;
+			}
+			time_ = time;
+			auto max_age = path_cache_max_age.load();
+			while (!entries_.empty() && time_ - entries_.back().time > max_age) {
+				erase(std::prev(entries_.end()));
+			}
+		}
+
+		auto erase(entries_type::iterator entry) -> void {
+			bytes_ -= entry->bytes;
+			index_.erase(entry->key);
+			entries_.erase(entry);
+		}
+
+		auto insert(entry_type entry) -> void {
+			auto max_bytes = path_cache_max_bytes.load();
+			if (entry.bytes > max_bytes) {
+				return;
+			}
+			// A recursive search from the room callback may have saved the same query
+			if (auto found = index_.find(entry.key); found != index_.end()) {
+				erase(found->second);
+			}
+			bytes_ += entry.bytes;
+			entries_.push_front(std::move(entry));
+			index_.emplace(entries_.front().key, entries_.begin());
+			while (bytes_ > max_bytes) {
+				erase(std::prev(entries_.end()));
+			}
+		}
+
+		entries_type entries_;
+		std::unordered_map<key_type, entries_type::iterator, key_hash> index_;
+		std::size_t bytes_{};
+		int time_{};
+};
+
+// Each thread has its own cache, like its pathfinders
+export auto thread_path_cache() -> path_cache& {
+	thread_local path_cache cache;
+	return cache;
+}
+
+// Sets the memory cap of each thread's cache and the number of ticks an entry may go unused
+export auto configure_path_cache(int max_bytes, int max_age) -> void {
+	path_cache_max_bytes = static_cast<std::size_t>(std::max(max_bytes, 0));
+	path_cache_max_age = std::max(max_age, 0);
+}
+
+} // namespace screeps
@@ -3,25 +3,15 @@ module;
 export module screeps;
 export import :astar;
 export import :jps;
+export import :path_cache;
 export import :pf;
+export import :planner;
+export import :route;
+import :pool;
 import std;
 
 namespace screeps {
 
-// Per-process terrain data
-terrain_map_type terrain_map;
-
-// Loads static terrain data into module upfront
-std::mutex terrain_lock;
-auto load_terrain(const world_type& world) -> void {
-	std::lock_guard<std::mutex> lock{terrain_lock};
-	// Parse out terrain by rooms
-	for (const auto& entry : world) {
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
-		terrain_map[ std::bit_cast<std::uint16_t>(entry.room) ] = entry.terrain.data();
-	}
-}
-
 // Combine multiple delegates into one which can be used by the implementations
 template <class... Types>
 struct composite_delegate : public Types... {
@@ -31,7 +21,8 @@ struct composite_delegate : public Types... {
 // Look, and also potentially open up a new room
 template <class Callback, class RoomTable>
 [[nodiscard]] auto look_delegate<Callback, RoomTable>::look(indexed_position_t pos) const -> cost_t {
-	return room_table.get()[ *pos.room_index - 1 ].second(look_table, pos.xx % 50, pos.yy % 50);
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	return room_grids[ *pos.room_index - 1 ][ (pos.yy % 50 * 50) + (pos.xx % 50) ];
 }
 
 // Return cost of moving to a node
@@ -41,7 +32,8 @@ auto look_delegate<Callback, RoomTable>::look_open(world_position_t pos) -> std:
 	if (room_index == room_index_sentinel) {
 		return {room_index_sentinel, obstacle};
 	}
-	auto cost = room_table.get()[ *room_index - 1 ].second(look_table, pos.xx % 50, pos.yy % 50);
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto cost = cost_t{room_grids[ *room_index - 1 ][ (pos.yy % 50 * 50) + (pos.xx % 50) ]};
 	return {room_index, cost};
 }
 
@@ -50,9 +42,11 @@ template <class Callback, class RoomTable>
 auto look_delegate<Callback, RoomTable>::room_index_from_location(room_location_t location) -> room_index_t {
 	auto& room_table = this->room_table.get();
 	auto room_index = room_table.find(location);
+	auto rooms_used = admitted == nullptr ? room_table.size() : admitted->count;
 	if (room_index == RoomTable::sentinel) {
 		auto& blocked_rooms = this->blocked_rooms.get();
-		if (room_table.size() >= max_rooms || blocked_rooms.contains(location)) {
+		auto& stats = this->stats.get();
+		if (rooms_used >= max_rooms || blocked_rooms.contains(location) || (corridor != nullptr && !corridor->contains(location))) {
 			return room_index_sentinel;
 		}
 		auto room_id = std::bit_cast<std::uint16_t>(location);
@@ -60,11 +54,16 @@ auto look_delegate<Callback, RoomTable>::room_index_from_location(room_location_
 		const auto* terrain_ptr = terrain_map[ room_id ];
 		if (terrain_ptr == nullptr) {
 			blocked_rooms.insert(location);
+			++stats.rooms_blocked;
 			return room_index_sentinel;
 		}
+		auto called = std::chrono::steady_clock::now();
 		auto callback_result = room_callback(location);
+		stats.callback_time += nanoseconds_since(called);
+		++stats.callbacks;
 		if (std::holds_alternative<bool>(callback_result) && !std::get<bool>(callback_result)) {
 			blocked_rooms.insert(location);
+			++stats.rooms_blocked;
 			return room_index_sentinel;
 		}
 		constexpr auto unwrap = util::overloaded{
@@ -74,7 +73,25 @@ auto look_delegate<Callback, RoomTable>::room_index_from_location(room_location_
 			},
 		};
 		auto terrain = room_terrain{terrain_ptr, std::visit(unwrap, callback_result)};
-		return room_index_t{room_table.insert(std::pair{location, terrain})};
+		auto index = room_table.insert(std::pair{location, terrain});
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		terrain.resolve(look_table, room_grids[ index - 1 ]);
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		room_bits[ index - 1 ].assign(room_grids[ index - 1 ], look_table[ 0 ]);
+		++stats.rooms_opened;
+		if (admitted != nullptr) {
+			admitted->rooms.set(index - 1);
+			++admitted->count;
+		}
+		return room_index_t{index};
+	} else if (admitted != nullptr && !admitted->rooms.test(room_index - 1)) {
+		// Opened by an earlier search of the batch
+		if (rooms_used >= max_rooms || (corridor != nullptr && !corridor->contains(location))) {
+			return room_index_sentinel;
+		}
+		admitted->rooms.set(room_index - 1);
+		++admitted->count;
+		return room_index_t{room_index};
 	} else {
 		return room_index_t{room_index};
 	}
@@ -90,44 +107,135 @@ template <class Callback, class RoomTable>
 	return indexed_position_t{room_index, pos};
 }
 
-// Return the indexed parent of the given node
-template <class Heap>
-auto node_delegate<Heap>::parent_of(this auto& self, pos_index_t index) -> indexed_position_t {
+// Precomputed jumps for the room of `pos`, if its terrain costs are not changed by a cost matrix
+template <class Callback, class RoomTable>
+[[nodiscard]] auto look_delegate<Callback, RoomTable>::jump_table(indexed_position_t pos) const -> const jump_table_t* {
+	// Plain and swamp must be distinguishable, since jumps stop when the terrain cost changes
+	if (look_table[ 0 ] == look_table[ 2 ] || room_table.get()[ *pos.room_index - 1 ].second.has_cost_matrix()) {
+		return nullptr;
+	}
+	return jump_tables(pos.room());
+}
+
+// Bitboards for the room of `pos`, for jumps over plain cost tiles
+template <class Callback, class RoomTable>
+[[nodiscard]] auto look_delegate<Callback, RoomTable>::jump_bits(indexed_position_t pos) const -> const jump_bits_t& {
 	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	return room_bits[ *pos.room_index - 1 ];
+}
+
+// Return the indexed parent of the given node
+template <class Heap, class Heuristic, class Nodes>
+auto node_delegate<Heap, Heuristic, Nodes>::parent_of(this auto& self, pos_index_t index) -> indexed_position_t {
 	return indexed_position_t{self.room_table.get(), self.parents[ *index ]};
 }
 
 // Push a new node to the heap, or update its cost if it already exists
-template <class Heap>
-auto node_delegate<Heap>::push_node(indexed_position_t node, pos_index_t parent_index, cost_t g_cost) -> void {
+template <class Heap, class Heuristic, class Nodes>
+auto node_delegate<Heap, Heuristic, Nodes>::push_node(this auto& self, indexed_position_t node, pos_index_t parent_index, cost_t g_cost) -> void {
 	auto index = pos_index_t{node};
-	if (open_closed.is_closed(*index)) {
+	if (self.open_closed.is_closed(*index)) {
 		return;
 	}
-	auto h_cost = static_cast<cost_t>(heuristic(node) * heuristic_weight);
+	auto h_cost = static_cast<cost_t>(self.heuristic(node) * self.heuristic_weight);
 	auto f_cost = h_cost + g_cost;
+	auto entry = make_heap_node<typename Heap::value_type>(index, f_cost, h_cost);
 
-	if (open_closed.is_open(*index)) {
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-		if (scores[ *index ] > f_cost) {
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-			scores[ *index ] = f_cost;
-			heap.get().push({index, f_cost});
-			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-			parents[ *index ] = parent_index;
+	if (self.open_closed.is_open(*index)) {
+		if (self.scores[ *index ] > f_cost) {
+			self.scores[ *index ] = f_cost;
+			self.heap.get().push(entry);
+			self.parents[ *index ] = parent_index;
+			++self.stats.get().pushed;
 			// std::print("~ {}: h({}) + g({}) = f({})\n", node, h_cost, g_cost, f_cost);
 		}
 	} else {
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-		scores[ *index ] = f_cost;
-		heap.get().push({index, f_cost});
-		open_closed.open(*index);
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-		parents[ *index ] = parent_index;
+		self.scores[ *index ] = f_cost;
+		self.heap.get().push(entry);
+		self.open_closed.open(*index);
+		self.parents[ *index ] = parent_index;
+		++self.stats.get().pushed;
 		// std::print("+ {}: h({}) + g({}) = f({})\n", node, h_cost, g_cost, f_cost);
 	}
 }
 
+// Push a node to this frontier and record it as a meeting point if the opposite frontier has also
+// reached it. Rejected pushes are skipped since the node already has a label at least as cheap,
+// which was checked when it was pushed.
+template <class Heap>
+auto meeting_delegate<Heap>::push_node(this auto& self, indexed_position_t node, pos_index_t parent_index, cost_t g_cost) -> void {
+	auto index = pos_index_t{node};
+	if (self.open_closed.is_closed(*index)) {
+		return;
+	}
+	auto f_cost = g_cost + static_cast<cost_t>(self.heuristic(node) * self.heuristic_weight);
+	self.node_delegate<Heap>::push_node(node, parent_index, g_cost);
+	if (self.scores[ *index ] != f_cost) {
+		return;
+	}
+	const auto& opposite = *self.opposite;
+	if (opposite.open_closed.is_open(*index) || opposite.open_closed.is_closed(*index)) {
+		auto opposite_g_cost = opposite.scores[ *index ] - static_cast<cost_t>(opposite.heuristic(node) * opposite.heuristic_weight);
+		auto& meeting = self.meeting.get();
+		if (g_cost + opposite_g_cost < meeting.cost) {
+			meeting = {.cost = g_cost + opposite_g_cost, .index = index};
+		}
+	}
+}
+
+// Generic iteration step used for forward/reverse and astar/jps expansions
+constexpr auto make_iterate = [](auto& delegate, auto& min_node, auto& min_node_h_cost, auto& min_node_g_cost, auto max_cost) -> auto {
+	auto open_closed = delegate.open_closed;
+	auto scores = delegate.scores;
+	auto& heap = delegate.heap.get();
+	auto& room_table = delegate.room_table.get();
+	auto& stats = delegate.stats.get();
+	return [ &, open_closed, scores, max_cost ](auto algorithm) mutable -> bool {
+		while (!heap.empty()) {
+			// Pull cheapest open node off the heap; discard stale entries
+			auto node = heap.top();
+			auto current = node.pos;
+			auto score = node.score;
+			heap.pop();
+			++stats.popped;
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			if (scores[ *current ] != score) {
+				++stats.stale;
+				continue;
+			}
+			open_closed.close(*current);
+
+			// Calculate costs
+			auto pos = indexed_position_t{room_table, current};
+			cost_t h_cost = delegate.heuristic(pos);
+			cost_t g_cost = score - static_cast<int>(h_cost * delegate.heuristic_weight);
+			// std::print("\n* {}: h({}) + g({}) = f({})\n", pos, h_cost, g_cost, score);
+
+			if (h_cost == 0) {
+				// Reached destination
+				min_node = pos;
+				min_node_h_cost = 0;
+				min_node_g_cost = g_cost;
+				break;
+			} else if (h_cost < min_node_h_cost) {
+				// Found better path
+				min_node = pos;
+				min_node_h_cost = h_cost;
+				min_node_g_cost = g_cost;
+			}
+			if (g_cost + h_cost > max_cost) {
+				// Exceeded cost budget
+				break;
+			}
+
+			// Add next neighbors to heap
+			algorithm(delegate, pos, current, g_cost);
+			return true;
+		}
+		return false;
+	};
+};
+
 // Perform the search~
 template <auto Check, class Callback, std::size_t RoomCapacity>
 auto pathfinder<Check, Callback, RoomCapacity>::search(
@@ -136,6 +244,78 @@ auto pathfinder<Check, Callback, RoomCapacity>::search(
 	heuristic_t heuristic,
 	const options& options
 ) -> std::optional<result> {
+	// Counters of this search, including a hierarchical search which is repeated over all rooms
+	auto scope = stats_scope{instance_state_->stats};
+
+	// Nothing to search for
+	if (heuristic.goals().empty()) {
+		return result{.path = std::ranges::subrange{path_iterator{sentinel_path_iterator{}}, sentinel_path_iterator{}}};
+	}
+
+	// Goals in another terrain component than the origin would only be found unreachable after
+	// expanding everything within `max_ops`. Unreachable goals are dropped, and if none are left the
+	// search fails right away.
+	auto reachable = std::vector<heuristic_t::goal_t>{};
+	if (options.terrain_only && !heuristic.flee()) {
+		if (auto table = components()) {
+			auto goals = heuristic.goals();
+			std::ranges::copy_if(goals, std::back_inserter(reachable), [ & ](const heuristic_t::goal_t& goal) -> bool {
+				return is_reachable(*table, origin, goal.pos, goal.range);
+			});
+			if (reachable.empty()) {
+				return result{
+					.path = std::ranges::subrange{path_iterator{sentinel_path_iterator{}}, sentinel_path_iterator{}},
+					.incomplete = true,
+				};
+			} else if (reachable.size() == 1 && goals.size() > 1) {
+				heuristic = heuristic_t{reachable.front(), false};
+			} else if (reachable.size() < goals.size()) {
+				heuristic = heuristic_t{std::span<const heuristic_t::goal_t>{reachable}, false};
+			}
+		}
+	}
+
+	if (options.hierarchical) {
+		// Plan a corridor of rooms on the abstract graph first and then search tiles within it. Cost
+		// matrices or a room callback can block the planned corridor, in which case the search is
+		// repeated over all rooms.
+		auto unrestricted = options;
+		unrestricted.hierarchical = false;
+		const auto* goal = heuristic.forward_goal();
+		if (goal != nullptr) {
+			if (auto corridor = plan_corridor(origin, goal->pos)) {
+				auto result = search_tiles(room_callback, origin, heuristic, unrestricted, &*corridor);
+				if (!result || !result->incomplete || result->ops >= options.max_ops || result->timed_out) {
+					return result;
+				}
+				// The repeated search only gets what is left of the ops and time budgets
+				auto corridor_ops = result->ops;
+				unrestricted.max_ops = options.max_ops - corridor_ops;
+				if (options.max_time > 0) {
+					auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - scope.started()).count();
+					unrestricted.max_time = std::max(options.max_time - static_cast<int>(elapsed), 1);
+				}
+				result = search_tiles(std::move(room_callback), origin, std::move(heuristic), unrestricted, nullptr);
+				if (result) {
+					result->ops += corridor_ops;
+				}
+				return result;
+			}
+		}
+		return search_tiles(std::move(room_callback), origin, std::move(heuristic), unrestricted, nullptr);
+	}
+	return search_tiles(std::move(room_callback), origin, std::move(heuristic), options, nullptr);
+}
+
+// Tile-level search, optionally restricted to a corridor of rooms
+template <auto Check, class Callback, std::size_t RoomCapacity>
+auto pathfinder<Check, Callback, RoomCapacity>::search_tiles(
+	Callback room_callback,
+	world_position_t origin,
+	heuristic_t heuristic,
+	const options& options,
+	const blocked_rooms_type* corridor
+) -> std::optional<result> {
 
 	// Special case for searching to same node, otherwise it searches everywhere because origin node
 	// is closed
@@ -144,9 +324,22 @@ auto pathfinder<Check, Callback, RoomCapacity>::search(
 		return result{.path = empty_path};
 	}
 
-	// Clean up from previous iteration
-	instance_state_.heap.clear();
-	instance_state_.room_table.clear();
+	// Clean up from previous iteration. Queries of a batch keep the rooms of earlier queries while
+	// they resolve terrain with the same costs and enough room indices are left.
+	auto look_table = terrain_cost_type{{std::clamp(options.plain_cost, 1, 0xfe), obstacle, std::clamp(options.swamp_cost, 1, 0xfe), obstacle}};
+	auto max_rooms = static_cast<unsigned>(std::clamp(options.max_rooms, 1, static_cast<int>(RoomCapacity)));
+	auto admitted = admitted_rooms{};
+	auto& room_table = instance_state_->room_table;
+	auto shared = batch_ && batch_look_table_ == look_table && room_table.size() + max_rooms <= RoomCapacity;
+	instance_state_->heap.clear();
+	if (!shared) {
+		using state_type = instance_state<RoomCapacity>;
+		if (reverse_state_ && room_table.size() > state_type::resident_rooms) {
+			reverse_state_->nodes.release_from(state_type::resident_rooms * k_room_size);
+		}
+		instance_state_->clear_rooms();
+		batch_look_table_ = look_table;
+	}
 
 	// Algorithm delegate
 	auto blocked_rooms = blocked_rooms_type{};
@@ -155,17 +348,22 @@ auto pathfinder<Check, Callback, RoomCapacity>::search(
 		node_delegate{
 			.heuristic = std::move(heuristic),
 			.heuristic_weight = std::clamp(options.heuristic_weight, 1., 9.),
-			.open_closed = instance_state_.open_closed.clear_and_make_view(),
-			.scores = instance_state_.scores.data(),
-			.parents = instance_state_.parents.data(),
-			.heap = std::ref(instance_state_.heap),
+			.open_closed = instance_state_->nodes.clear_and_make_view(),
+			.scores = instance_state_->nodes.scores(),
+			.parents = instance_state_->nodes.parents(),
+			.heap = std::ref(instance_state_->heap),
 		},
 		look_delegate{
-			.max_rooms = static_cast<unsigned>(std::clamp(options.max_rooms, 1, static_cast<int>(RoomCapacity))),
-			.look_table = {{std::clamp(options.plain_cost, 1, 0xfe), obstacle, std::clamp(options.swamp_cost, 1, 0xfe), obstacle}},
+			.max_rooms = max_rooms,
+			.look_table = look_table,
 			.room_callback = std::move(room_callback),
 			.blocked_rooms = std::ref(blocked_rooms),
-			.room_table = std::ref(instance_state_.room_table),
+			.room_table = std::ref(room_table),
+			.room_grids = instance_state_->room_grids.data(),
+			.room_bits = instance_state_->room_bits.data(),
+			.stats = std::ref(instance_state_->stats),
+			.corridor = corridor,
+			.admitted = batch_ ? &admitted : nullptr,
 		}
 	};
 
@@ -178,9 +376,55 @@ auto pathfinder<Check, Callback, RoomCapacity>::search(
 		};
 	}
 
+	// Bidirectional search needs exactly one target to grow the goal frontier from
+	if (options.bidirectional) {
+		const auto* goal = delegate.heuristic.forward_goal();
+		if (goal != nullptr && goal->range <= k_max_bidirectional_range) {
+			return search_bidirectional(delegate, origin, *goal, options);
+		}
+	}
+
+	// Landmark bounds are opt-in since a cost matrix which makes a wall walkable breaks them
+	auto bounds = std::optional<landmark_bounds>{};
+	if (options.landmarks) {
+		const auto* goal = delegate.heuristic.forward_goal();
+		auto table = landmarks();
+		if (goal != nullptr && goal->range <= k_max_landmark_range && table != nullptr) {
+			delegate.heuristic.with_landmarks(bounds.emplace(std::move(table), goal->pos, goal->range));
+		}
+	}
+
+	// Resolve the heuristic callback once here so that `astar` and `jps` can inline it
+	using heap_type = instance_state<RoomCapacity>::heap_type;
+	using look_delegate_type = look_delegate<Callback, typename instance_state<RoomCapacity>::room_scope_table>;
+	return delegate.heuristic.specialize([ & ](auto heuristic) -> std::optional<result> {
+		auto specialized = composite_delegate{
+			node_delegate<heap_type, decltype(heuristic)>{
+				.heuristic = std::move(heuristic),
+				.heuristic_weight = delegate.heuristic_weight,
+				.open_closed = delegate.open_closed,
+				.scores = delegate.scores,
+				.parents = delegate.parents,
+				.heap = delegate.heap,
+			},
+			std::move(static_cast<look_delegate_type&>(delegate)),
+		};
+		return search_loop(specialized, origin, options, max_cost);
+	});
+}
+
+// Main loop of `search_tiles`
+template <auto Check, class Callback, std::size_t RoomCapacity>
+auto pathfinder<Check, Callback, RoomCapacity>::search_loop(
+	auto& delegate,
+	world_position_t origin,
+	const options& options,
+	cost_t max_cost
+) -> std::optional<result> {
+
 	// Local state
-	auto* parents = delegate.parents;
-	auto* scores = delegate.scores;
+	auto parents = delegate.parents;
+	auto scores = delegate.scores;
 	auto& room_table = delegate.room_table.get();
 	auto ops_remaining = std::clamp(options.max_ops, 1, std::numeric_limits<int>::max());
 	auto min_node_g_cost = 0;
@@ -190,92 +434,500 @@ auto pathfinder<Check, Callback, RoomCapacity>::search(
 	auto min_node = delegate.index_from_pos(origin);
 	auto index = pos_index_t{min_node};
 	delegate.open_closed.close(*index);
-	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 	parents[ *index ] = sentinel_pos_index;
-	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-	scores[ *index ] = static_cast<cost_t>(heuristic(origin) * delegate.heuristic_weight); // g_cost == 0
+	scores[ *index ] = static_cast<cost_t>(delegate.heuristic(origin) * delegate.heuristic_weight); // g_cost == 0
 	astar(delegate, min_node, index, 0);
 
-	// Generic iteration step used for forward/reverse and astar/jps expansions
-	constexpr auto make_iterate = [](auto& delegate, auto& min_node, auto& min_node_h_cost, auto& min_node_g_cost, auto max_cost) -> auto {
-		auto open_closed = delegate.open_closed;
-		auto* scores = delegate.scores;
-		auto& heap = delegate.heap.get();
-		auto& room_table = delegate.room_table.get();
-		return [ &, open_closed, scores, max_cost ](auto algorithm) mutable -> bool {
-			while (!heap.empty()) {
-				// Pull cheapest open node off the heap; discard stale entries
-				auto [ current, score ] = heap.top();
-				heap.pop();
-				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
-				if (scores[ *current ] != score) {
-					continue;
-				}
-				open_closed.close(*current);
-
-				// Calculate costs
-				auto pos = indexed_position_t{room_table, current};
-				cost_t h_cost = delegate.heuristic(pos);
-				cost_t g_cost = score - static_cast<int>(h_cost * delegate.heuristic_weight);
-				// std::print("\n* {}: h({}) + g({}) = f({})\n", pos, h_cost, g_cost, score);
-
-				if (h_cost == 0) {
-					// Reached destination
-					min_node = pos;
-					min_node_h_cost = 0;
-					min_node_g_cost = g_cost;
-					break;
-				} else if (h_cost < min_node_h_cost) {
-					// Found better path
-					min_node = pos;
-					min_node_h_cost = h_cost;
-					min_node_g_cost = g_cost;
-				}
-				if (g_cost + h_cost > max_cost) {
-					// Exceeded cost budget
-					break;
-				}
+	// Loop until we have a solution
+	auto iterate = make_iterate(delegate, min_node, min_node_h_cost, min_node_g_cost, max_cost);
+	auto clock = search_clock<Check>{options};
+	auto dispatch = [ &, iterate ](auto algorithm) mutable -> void {
+		while (ops_remaining > 0 && iterate(algorithm)) {
+			--ops_remaining;
+			if (!clock()) {
+				break;
+			}
+		}
+	};
+	auto expanding = std::chrono::steady_clock::now();
+	if (delegate.heuristic_weight == 1) {
+		// jps can sometimes produce suboptimal paths with non-uniform cost grids even with the added
+		// forced neighbor heuristic. so, for heuristicWeight == 1 we will use astar for the best
+		// paths.
+		dispatch(astar);
+	} else {
+		dispatch(jps);
+	}
+	delegate.stats.get().expand_time += nanoseconds_since(expanding);
+
+	// Reconstruct path from A* graph
+	return result{
+		.path = std::ranges::subrange{
+			path_iterator{room_table, parents, pos_index_t{min_node}},
+			sentinel_path_iterator{},
+		},
+		.cost = min_node_g_cost,
+		.ops = options.max_ops - ops_remaining,
+		.incomplete = min_node_h_cost != 0,
+		.timed_out = clock.expired(),
+	};
+}
+
+// Bidirectional A*. The origin frontier runs forward as usual and the goal frontier runs over
+// reversed edges toward the origin. Whenever a node is labeled by both we have a candidate path,
+// and once the cheapest open node of either frontier costs at least as much as the best candidate
+// no cheaper path can exist.
+template <auto Check, class Callback, std::size_t RoomCapacity>
+auto pathfinder<Check, Callback, RoomCapacity>::search_bidirectional(
+	auto& delegate,
+	world_position_t origin,
+	const heuristic_t::goal_t& goal,
+	const options& options
+) -> std::optional<result> {
+	using heap_type = instance_state<RoomCapacity>::heap_type;
+	using look_delegate_type = look_delegate<Callback, typename instance_state<RoomCapacity>::room_scope_table>;
+
+	// Goal frontier state is only allocated once it is needed
+	if (reverse_state_ == nullptr) {
+		reverse_state_ = std::make_unique_for_overwrite<reverse_state<RoomCapacity>>();
+	}
+	auto& reverse_state = *reverse_state_;
+	reverse_state.heap.clear();
+
+	// Both frontiers share terrain and rooms but keep their own node state. The search stops once
+	// either frontier's cheapest open node costs at least as much as the best meeting, which only
+	// holds for an admissible heuristic, so `heuristic_weight` is ignored.
+	auto meeting = meeting_t{};
+	auto forward = composite_delegate{
+		meeting_delegate<heap_type>{static_cast<const node_delegate<heap_type>&>(delegate), nullptr, std::ref(meeting)},
+		static_cast<const look_delegate_type&>(delegate),
+	};
+	forward.heuristic_weight = 1;
+	auto reverse = composite_delegate{
+		meeting_delegate<heap_type>{
+			node_delegate<heap_type>{
+				.heuristic = heuristic_t{heuristic_t::goal_t{.range = 0, .pos = origin}, false},
+				.heuristic_weight = 1,
+				.open_closed = reverse_state.nodes.clear_and_make_view(),
+				.scores = reverse_state.nodes.scores(),
+				.parents = reverse_state.nodes.parents(),
+				.heap = std::ref(reverse_state.heap),
+			},
+			&forward,
+			std::ref(meeting),
+		},
+		static_cast<const look_delegate_type&>(delegate),
+	};
+	forward.opposite = &reverse;
 
-				// Add next neighbors to heap
-				algorithm(delegate, pos, current, g_cost);
-				return true;
+	// Seed the goal frontier with every tile in range of the goal
+	for (auto yy = std::max(goal.pos.yy - goal.range, 0); yy <= std::min(goal.pos.yy + goal.range, k_world_edge); ++yy) {
+		for (auto xx = std::max(goal.pos.xx - goal.range, 0); xx <= std::min(goal.pos.xx + goal.range, k_world_edge); ++xx) {
+			auto pos = world_position_t{xx, yy};
+			auto [ room_index, cost ] = reverse.look_open(pos);
+			if (cost != obstacle) {
+				reverse.push_node({room_index, pos}, sentinel_pos_index, 0);
 			}
-			return false;
+		}
+	}
+
+	// Local state
+	auto& room_table = delegate.room_table.get();
+	auto& forward_heap = forward.heap.get();
+	auto& reverse_heap = reverse.heap.get();
+	auto max_cost = std::clamp(options.max_cost, 1, std::numeric_limits<cost_t>::max());
+	auto ops_remaining = std::clamp(options.max_ops, 1, std::numeric_limits<int>::max());
+	auto min_node_g_cost = 0;
+	auto min_node_h_cost = std::numeric_limits<cost_t>::max();
+	auto reverse_min_node_g_cost = 0;
+	auto reverse_min_node_h_cost = std::numeric_limits<cost_t>::max();
+
+	// Initial iteration of the origin frontier
+	auto min_node = forward.index_from_pos(origin);
+	auto index = pos_index_t{min_node};
+	auto reverse_min_node = min_node;
+	forward.open_closed.close(*index);
+	forward.parents[ *index ] = sentinel_pos_index;
+	forward.scores[ *index ] = static_cast<cost_t>(forward.heuristic(origin) * forward.heuristic_weight);
+	astar(forward, min_node, index, 0);
+
+	// Always expand the frontier with the cheaper open node
+	auto iterate_forward = make_iterate(forward, min_node, min_node_h_cost, min_node_g_cost, max_cost);
+	auto iterate_reverse = make_iterate(reverse, reverse_min_node, reverse_min_node_h_cost, reverse_min_node_g_cost, max_cost);
+	auto clock = search_clock<Check>{options};
+	auto expanding = std::chrono::steady_clock::now();
+	while (ops_remaining > 0 && !forward_heap.empty()) {
+		auto forward_score = forward_heap.top().score;
+		auto reverse_score = reverse_heap.empty() ? std::numeric_limits<cost_t>::max() : reverse_heap.top().score;
+		if (forward_score >= meeting.cost || (!reverse_heap.empty() && reverse_score >= meeting.cost)) {
+			break;
+		}
+		auto expand_reverse = reverse_score < forward_score;
+		if (!(expand_reverse ? iterate_reverse(reverse_astar) : iterate_forward(astar))) {
+			if (expand_reverse && reverse_heap.empty()) {
+				// Goal frontier is exhausted, the origin frontier continues alone
+				continue;
+			}
+			break;
+		}
+		--ops_remaining;
+		if (!clock()) {
+			break;
+		}
+	}
+	delegate.stats.get().expand_time += nanoseconds_since(expanding);
+
+	if (meeting.index != sentinel_pos_index) {
+		// Join the two halves at the meeting node
+		auto start = path_iterator::splice(forward.parents, reverse.parents, meeting.index);
+		return result{
+			.path = std::ranges::subrange{
+				path_iterator{room_table, forward.parents, start},
+				sentinel_path_iterator{},
+			},
+			.cost = meeting.cost,
+			.ops = options.max_ops - ops_remaining,
+			.timed_out = clock.expired(),
 		};
+	}
+
+	// Frontiers never met, reconstruct a partial path from the origin frontier
+	return result{
+		.path = std::ranges::subrange{
+			path_iterator{room_table, forward.parents, pos_index_t{min_node}},
+			sentinel_path_iterator{},
+		},
+		.cost = min_node_g_cost,
+		.ops = options.max_ops - ops_remaining,
+		.incomplete = true,
+		.timed_out = clock.expired(),
 	};
+}
 
-	// Loop until we have a solution
-	try {
-		auto iterate = make_iterate(delegate, min_node, min_node_h_cost, min_node_g_cost, max_cost);
+// Run a batch of searches with one room callback. Rooms stay open between queries, and the callback
+// is expected to be memoized by the caller for rooms which have to be opened again.
+template <auto Check, class Callback, std::size_t RoomCapacity>
+auto pathfinder<Check, Callback, RoomCapacity>::search_many(
+	Callback room_callback,
+	std::span<const batch_query> queries
+) -> std::vector<batch_result> {
+	batch_ = true;
+	batch_look_table_.reset();
+	auto after = util::scope_exit{[ & ] { batch_ = false; }};
+	auto results = std::vector<batch_result>{};
+	results.reserve(queries.size());
+	for (const auto& query : queries) {
+		auto& entry = results.emplace_back();
+		if (query.goals.empty()) {
+			continue;
+		}
+		auto heuristic = query.goals.size() == 1
+			? heuristic_t{query.goals.front(), query.flee}
+			: heuristic_t{std::span{query.goals}, query.flee};
+		auto result = search(room_callback, query.origin, heuristic, query.search_options);
+		if (result) {
+			std::ranges::copy(result->path, std::back_inserter(entry.path));
+			entry.cost = result->cost;
+			entry.ops = result->ops;
+			entry.incomplete = result->incomplete;
+		} else {
+			entry.incomplete = true;
+		}
+	}
+	return results;
+}
+
+// Dijkstra flood over reversed edges from every goal. Writes the cost to the nearest goal and the
+// direction of the next step toward it for each tile of each opened room, in the order of the
+// returned rooms.
+template <auto Check, class Callback, std::size_t RoomCapacity>
+auto pathfinder<Check, Callback, RoomCapacity>::distance_field(
+	Callback room_callback,
+	heuristic_t heuristic,
+	const options& options,
+	std::span<std::uint16_t> distances,
+	std::span<std::uint8_t> directions
+) -> std::vector<room_location_t> {
+	// Output buffers limit the number of rooms
+	constexpr auto room_size = std::size_t{k_room_size};
+	auto capacity = std::min({distances.size(), directions.size(), RoomCapacity * room_size}) / room_size;
+	if (capacity == 0) {
+		return {};
+	}
+
+	// Clean up from previous iteration
+	auto scope = stats_scope{instance_state_->stats};
+	instance_state_->heap.clear();
+	instance_state_->clear_rooms();
+
+	// Algorithm delegate. The heuristic is always zero.
+	auto blocked_rooms = blocked_rooms_type{};
+	auto delegate = composite_delegate{
+		node_delegate{
+			.heuristic = heuristic_t{heuristic_t::goal_t{}, true},
+			.heuristic_weight = 1,
+			.open_closed = instance_state_->nodes.clear_and_make_view(),
+			.scores = instance_state_->nodes.scores(),
+			.parents = instance_state_->nodes.parents(),
+			.heap = std::ref(instance_state_->heap),
+		},
+		look_delegate{
+			.max_rooms = static_cast<unsigned>(std::clamp(options.max_rooms, 1, static_cast<int>(capacity))),
+			.look_table = {{std::clamp(options.plain_cost, 1, 0xfe), obstacle, std::clamp(options.swamp_cost, 1, 0xfe), obstacle}},
+			.room_callback = std::move(room_callback),
+			.blocked_rooms = std::ref(blocked_rooms),
+			.room_table = std::ref(instance_state_->room_table),
+			.room_grids = instance_state_->room_grids.data(),
+			.room_bits = instance_state_->room_bits.data(),
+			.stats = std::ref(instance_state_->stats),
+		}
+	};
+
+	// Local state
+	auto parents = delegate.parents;
+	auto scores = delegate.scores;
+	auto& heap = delegate.heap.get();
+	auto& room_table = delegate.room_table.get();
+	auto max_cost = std::clamp(options.max_cost, 1, std::numeric_limits<cost_t>::max());
+	auto ops_remaining = std::clamp(options.max_ops, 1, std::numeric_limits<int>::max());
+
+	// Seed every walkable tile in range of a goal
+	for (const auto& goal : heuristic.goals()) {
+		for (auto yy = std::max(goal.pos.yy - goal.range, 0); yy <= std::min(goal.pos.yy + goal.range, k_world_edge); ++yy) {
+			for (auto xx = std::max(goal.pos.xx - goal.range, 0); xx <= std::min(goal.pos.xx + goal.range, k_world_edge); ++xx) {
+				auto pos = world_position_t{xx, yy};
+				auto [ room_index, cost ] = delegate.look_open(pos);
+				if (cost != obstacle) {
+					delegate.push_node({room_index, pos}, sentinel_pos_index, 0);
+				}
+			}
+		}
+	}
+
+	// Flood until the budget runs out
+	auto clock = search_clock<Check>{options};
+	auto& stats = delegate.stats.get();
+	auto expanding = std::chrono::steady_clock::now();
+	while (ops_remaining > 0 && !heap.empty()) {
+		auto node = heap.top();
+		auto current = node.pos;
+		auto score = node.score;
+		heap.pop();
+		++stats.popped;
+		if (scores[ *current ] != score) {
+			++stats.stale;
+			continue;
+		} else if (score > max_cost) {
+			break;
+		}
+		delegate.open_closed.close(*current);
+		reverse_astar(delegate, indexed_position_t{room_table, current}, current, score);
+		--ops_remaining;
+		if (!clock()) {
+			break;
+		}
+	}
+	stats.expand_time += nanoseconds_since(expanding);
+
+	// Write out each opened room. Only closed tiles have final costs.
+	auto rooms = std::vector<room_location_t>{};
+	for (std::size_t ii = 0; ii < room_table.size(); ++ii) {
+		rooms.push_back(room_table[ ii ].first);
+		for (std::size_t tile = 0; tile < room_size; ++tile) {
+			auto offset = (ii * room_size) + tile;
+			auto index = pos_index_t{static_cast<int>(offset)};
+			if (delegate.open_closed.is_closed(*index)) {
+				auto parent = parents[ *index ];
+				distances[ offset ] = static_cast<std::uint16_t>(std::min(scores[ *index ], cost_t{0xffff}));
+				directions[ offset ] = parent == sentinel_pos_index ? 0 : [ & ] {
+					auto pos = indexed_position_t{room_table, index};
+					auto next = indexed_position_t{room_table, parent};
+					return static_cast<std::uint8_t>(static_cast<int>(pos.direction_to(next)) + 1);
+				}();
+			} else {
+				distances[ offset ] = 0xffff;
+				directions[ offset ] = 0;
+			}
+		}
+	}
+	return rooms;
+}
+
+template <auto Check, class Callback, std::size_t RoomCapacity>
+search_session<Check, Callback, RoomCapacity>::search_session(
+	world_position_t origin,
+	goals_type goals,
+	bool flee,
+	const options& options
+) :
+		origin_{origin},
+		goals_{std::move(goals)},
+		heuristic_{goals_.size() == 1 ? heuristic_t{goals_.front(), flee} : heuristic_t{std::span{goals_}, flee}},
+		options_{options},
+		open_closed_{state_->nodes.clear_and_make_view()} {}
+
+// Continue an A* or JPS search from its saved state, as in `search_tiles`
+template <auto Check, class Callback, std::size_t RoomCapacity>
+auto search_session<Check, Callback, RoomCapacity>::resume(Callback room_callback, int max_ops) -> search_progress {
+	running_ = true;
+	auto after = util::scope_exit{[ & ] { running_ = false; }};
+	auto scope = stats_scope{state_->stats};
+	auto delegate = composite_delegate{
+		node_delegate{
+			.heuristic = heuristic_,
+			.heuristic_weight = std::clamp(options_.heuristic_weight, 1., 9.),
+			.open_closed = open_closed_,
+			.scores = state_->nodes.scores(),
+			.parents = state_->nodes.parents(),
+			.heap = std::ref(state_->heap),
+		},
+		look_delegate{
+			.max_rooms = static_cast<unsigned>(std::clamp(options_.max_rooms, 1, static_cast<int>(RoomCapacity))),
+			.look_table = {{std::clamp(options_.plain_cost, 1, 0xfe), obstacle, std::clamp(options_.swamp_cost, 1, 0xfe), obstacle}},
+			.room_callback = std::move(room_callback),
+			.blocked_rooms = std::ref(blocked_rooms_),
+			.room_table = std::ref(state_->room_table),
+			.room_grids = state_->room_grids.data(),
+			.room_bits = state_->room_bits.data(),
+			.stats = std::ref(state_->stats),
+		}
+	};
+
+	// Initial A* iteration
+	if (!started_) {
+		started_ = true;
+		if (goals_.empty() || heuristic_(origin_) == 0) {
+			done_ = true;
+			return search_progress{.done = true};
+		} else if (delegate.room_index_from_location(origin_.room()) == room_index_sentinel) {
+			done_ = true;
+			return search_progress{.incomplete = true, .done = true};
+		}
+		min_node_ = delegate.index_from_pos(origin_);
+		auto index = pos_index_t{min_node_};
+		delegate.open_closed.close(*index);
+		state_->nodes.parents()[ *index ] = sentinel_pos_index;
+		state_->nodes.scores()[ *index ] = static_cast<cost_t>(heuristic_(origin_) * delegate.heuristic_weight);
+		astar(delegate, min_node_, index, 0);
+	} else if (min_node_.room_index == room_index_sentinel) {
+		return search_progress{.incomplete = !goals_.empty() && heuristic_(origin_) != 0, .done = true};
+	}
+
+	// Expand nodes until the budget runs out or the search is done
+	auto ops_remaining = std::clamp(max_ops, 1, std::numeric_limits<int>::max());
+	if (!done_) {
+		auto budget = ops_remaining;
+		auto max_cost = std::clamp(options_.max_cost, 1, std::numeric_limits<cost_t>::max());
+		auto iterate = make_iterate(delegate, min_node_, min_node_h_cost_, min_node_g_cost_, max_cost);
+		auto clock = search_clock<Check>{options_};
 		auto dispatch = [ &, iterate ](auto algorithm) mutable -> void {
-			while (ops_remaining > 0 && iterate(algorithm)) {
+			while (ops_remaining > 0) {
+				if (!iterate(algorithm)) {
+					done_ = true;
+					break;
+				}
 				--ops_remaining;
-				Check();
+				if (!clock()) {
+					break;
+				}
 			}
 		};
+		auto expanding = std::chrono::steady_clock::now();
 		if (delegate.heuristic_weight == 1) {
-			// jps can sometimes produce suboptimal paths with non-uniform cost grids even with the added
-			// forced neighbor heuristic. so, for heuristicWeight == 1 we will use astar for the best
-			// paths.
 			dispatch(astar);
 		} else {
 			dispatch(jps);
 		}
-		// NOLINTNEXTLINE(bugprone-empty-catch)
-	} catch (const std::range_error&) {
-		// This error is, probably, a heap overflow. In this case all we can do is return a partial path.
+		delegate.stats.get().expand_time += nanoseconds_since(expanding);
+		ops_ += budget - ops_remaining;
 	}
 
-	// Reconstruct path from A* graph
-	return result{
-		.path = std::ranges::subrange{
-			path_iterator{room_table, parents, pos_index_t{min_node}},
+	// Path to the best node so far
+	auto progress = search_progress{
+		.cost = min_node_g_cost_,
+		.ops = ops_,
+		.incomplete = min_node_h_cost_ != 0,
+		.done = done_,
+	};
+	std::ranges::copy(
+		std::ranges::subrange{
+			path_iterator{state_->room_table, state_->nodes.parents(), pos_index_t{min_node_}},
 			sentinel_path_iterator{},
 		},
-		.cost = min_node_g_cost,
-		.ops = options.max_ops - ops_remaining,
-		.incomplete = min_node_h_cost != 0,
-	};
+		std::back_inserter(progress.path)
+	);
+	return progress;
+}
+
+// Searches run by `search_parallel` cannot be interrupted by the isolate
+auto no_termination_check() -> void {}
+
+// Each worker thread keeps its own pathfinder, allocated the first time it takes part in a batch
+using parallel_pathfinder_type = pathfinder<no_termination_check, static_room_callback, k_max_rooms>;
+
+// Process-wide pool for `search_parallel`. The calling thread also runs searches, so a batch runs
+// on up to N + 1 threads, and batches from several threads share the workers. There are no workers
+// until `configure_parallel_search` asks for some, since hosts usually run one process per core
+// already. Without workers each batch runs on its calling thread alone.
+std::mutex parallel_pool_lock;
+std::shared_ptr<worker_pool> parallel_pool_instance = std::make_shared<worker_pool>(0);
+
+auto parallel_pool() -> std::shared_ptr<worker_pool> {
+	std::lock_guard lock{parallel_pool_lock};
+	return parallel_pool_instance;
+}
+
+// Replaces the pool with one of `workers` threads, unless it already has that many. Batches which
+// are already running finish on the previous pool.
+export auto configure_parallel_search(int workers) -> void {
+	auto size = static_cast<unsigned>(std::clamp(workers, 0, 256));
+	if (parallel_pool()->size() == size) {
+		return;
+	}
+	auto pool = std::make_shared<worker_pool>(size);
+	{
+		std::lock_guard lock{parallel_pool_lock};
+		std::swap(parallel_pool_instance, pool);
+	}
+	// The previous pool is joined here, outside of the lock
+}
+
+// Run a batch of independent searches on the pool, blocking until every query is done. Room
+// callbacks cannot be invoked from the workers, so cost matrices are resolved by the caller. Idle
+// threads take the next unclaimed query, which keeps the cores busy when query costs vary.
+export auto search_parallel(
+	const std::vector<batch_query>& queries,
+	const std::vector<room_matrix>& matrices
+) -> std::vector<batch_result> {
+	auto resolved = static_room_callback::matrices_type{};
+	for (const auto& entry : matrices) {
+		resolved.insert_or_assign(entry.room, entry.matrix);
+	}
+	auto results = std::vector<batch_result>(queries.size());
+	auto next = std::atomic<std::size_t>{0};
+	auto error = std::exception_ptr{};
+	auto error_mutex = std::mutex{};
+	parallel_pool()->run([ & ] {
+		thread_local auto pf = std::unique_ptr<parallel_pathfinder_type>{};
+		try {
+			if (!pf) {
+				pf = std::make_unique<parallel_pathfinder_type>();
+			}
+			auto room_callback = static_room_callback{resolved};
+			for (auto ii = next++; ii < queries.size(); ii = next++) {
+				auto query = std::span{queries}.subspan(ii, 1);
+				results[ ii ] = std::move(pf->search_many(room_callback, query).front());
+			}
+		} catch (...) {
+			std::lock_guard lock{error_mutex};
+			error = std::current_exception();
+			next = queries.size();
+		}
+	});
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return results;
 }
 
 }; // namespace screeps
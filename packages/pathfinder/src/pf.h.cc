@@ -1,20 +1,40 @@
 export module screeps:pf;
+export import :components;
 export import :heap;
 export import :heuristic;
+export import :jump_table;
+export import :landmarks;
+export import :matrix_store;
 export import :open_closed;
 export import :position;
 export import :room;
+export import :stats;
+export import :terrain;
 export import :utility;
 import std;
 
 namespace screeps {
 
 constexpr auto k_room_size = 50 * 50;
-constexpr auto map_position_size = 1 << sizeof(room_location_t) * 8;
+// Most rooms which one search or planner may open. Pathfinders are sized for this many rooms, and
+// `max_rooms` is clamped to it.
+export constexpr auto k_max_rooms = std::size_t{256};
 constexpr auto sentinel_pos_index = pos_index_t{std::numeric_limits<pos_index_t::value_type>::max()};
+constexpr auto k_world_edge = (0x100 * 50) - 1;
+// Goal frontiers are seeded with every tile in range, so beyond about a room of tiles it is cheaper
+// to only search forward
+constexpr auto k_max_bidirectional_range = 24;
 export using room_callback_result_type = std::variant<std::monostate, bool, std::span<const std::uint8_t>>;
 using blocked_rooms_type = std::unordered_set<room_location_t, room_location_t::hash>;
 
+// Rooms of a room table which the running search has reached. A batch of searches keeps its rooms
+// between queries, so rooms left over from earlier queries only count against `max_rooms` and the
+// corridor once the running search reaches them.
+struct admitted_rooms {
+		std::bitset<k_max_rooms> rooms;
+		unsigned count{};
+};
+
 // Requirement for astar. Provides autocomplete via clangd.
 template <class Type>
 concept astar_pathfinder = requires(Type pf) {
@@ -28,34 +48,258 @@ concept jps_pathfinder = astar_pathfinder<Type> && requires(Type pf) {
 	{ pf.heuristic(indexed_position_t{}) } -> std::same_as<cost_t>;
 	{ pf.look(indexed_position_t{}) } -> std::same_as<cost_t>;
 	{ pf.parent_of(pos_index_t{}) } -> std::same_as<indexed_position_t>;
+	{ pf.jump_table(indexed_position_t{}) } -> std::same_as<const jump_table_t*>;
+	{ pf.jump_bits(indexed_position_t{}) } -> std::same_as<const jump_bits_t&>;
 };
 
 // Params for `search`
 using goals_type = std::vector<heuristic_t::goal_t>;
 struct options {
-		double heuristic_weight;
-		cost_t plain_cost;
-		cost_t swamp_cost;
-		int max_cost;
-		int max_ops;
-		int max_rooms;
+		double heuristic_weight{};
+		cost_t plain_cost{};
+		cost_t swamp_cost{};
+		int max_cost{};
+		int max_ops{};
+		int max_rooms{};
+		// Wall-clock budget in microseconds, 0 for none
+		int max_time{};
+		// Ops between termination and deadline checks, 0 for `k_check_interval`
+		int check_interval{};
+		bool bidirectional{};
+		bool hierarchical{};
+		bool landmarks{};
+		// Set when no room callback or matrix can make a terrain wall walkable, which lets goals that
+		// terrain cuts off from the origin be rejected upfront. Not offered to JS.
+		bool terrain_only{};
+
+		constexpr auto operator==(const options& right) const -> bool = default;
+
+		constexpr static auto struct_template = js::struct_template{
+			js::struct_member{util::cw<"bidirectional">, &options::bidirectional},
+			js::struct_member{util::cw<"checkInterval">, &options::check_interval},
+			js::struct_member{util::cw<"heuristicWeight">, &options::heuristic_weight},
+			js::struct_member{util::cw<"hierarchical">, &options::hierarchical},
+			js::struct_member{util::cw<"landmarks">, &options::landmarks},
+			js::struct_member{util::cw<"maxCost">, &options::max_cost},
+			js::struct_member{util::cw<"maxOps">, &options::max_ops},
+			js::struct_member{util::cw<"maxRooms">, &options::max_rooms},
+			js::struct_member{util::cw<"maxTime">, &options::max_time},
+			js::struct_member{util::cw<"plainCost">, &options::plain_cost},
+			js::struct_member{util::cw<"swampCost">, &options::swamp_cost},
+		};
+};
+
+// Polls `Check` and the `max_time` deadline once every `check_interval` ops. Both cost far more
+// than expanding a node, and a deadline which is a few hundred ops late is still close enough.
+constexpr auto k_check_interval = 256;
+
+export template <auto Check>
+class search_clock {
+	public:
+		using clock_type = std::chrono::steady_clock;
+
+		search_clock(int max_time, int check_interval) :
+				interval_{check_interval > 0 ? check_interval : k_check_interval},
+				countdown_{interval_} {
+			if (max_time > 0) {
+				deadline_ = clock_type::now() + std::chrono::microseconds{max_time};
+			}
+		}
+
+		explicit search_clock(const options& options) :
+				search_clock{options.max_time, options.check_interval} {}
+
+		// Invoked after each op. Returns false once the deadline has passed.
+		auto operator()() -> bool {
+			if (--countdown_ > 0) {
+				return true;
+			}
+			countdown_ = interval_;
+			Check();
+			expired_ = deadline_ && clock_type::now() >= *deadline_;
+			return !expired_;
+		}
+
+		[[nodiscard]] auto expired() const -> bool { return expired_; }
+
+	private:
+		std::optional<clock_type::time_point> deadline_;
+		int interval_;
+		int countdown_;
+		bool expired_{};
 };
 
-// Params for `load_terrain`
-struct room_entry {
+// Params for `searchMany`
+export struct batch_query {
+		world_position_t origin;
+		goals_type goals;
+		bool flee{};
+		options search_options;
+
+		constexpr static auto struct_template = js::struct_template{
+			js::struct_member{util::cw<"flee">, &batch_query::flee},
+			js::struct_member{util::cw<"goals">, &batch_query::goals},
+			js::struct_member{util::cw<"options">, &batch_query::search_options},
+			js::struct_member{util::cw<"origin">, &batch_query::origin},
+		};
+};
+
+// Cost matrix for one room of a `searchParallel` batch, or one preloaded for `search`. A missing
+// matrix blocks the room.
+export struct room_matrix {
 		room_location_t room;
-		terrain_span_type terrain;
+		std::optional<std::span<const std::uint8_t>> matrix;
 
 		constexpr static auto struct_template = js::struct_template{
-			js::struct_member{util::cw<"room">, &room_entry::room},
-			js::struct_member{util::cw<"terrain">, &room_entry::terrain},
+			js::struct_member{util::cw<"matrix">, &room_matrix::matrix},
+			js::struct_member{util::cw<"room">, &room_matrix::room},
 		};
 };
-export using world_type = std::vector<room_entry>;
-using terrain_map_type = std::array<terrain_type, map_position_size>;
 
-// Load process-wide shared terrain
-export auto load_terrain(const world_type& world) -> void;
+// What a search saw of one room, for `path_cache`. Stored matrices are identified by version, which
+// is unique across every store, and other matrices by their contents, so that a cached result is
+// never reused because of a hash collision. A state made from a callback result refers to its matrix
+// until `owned` copies it.
+export class room_state {
+	public:
+		using matrix_type = std::array<std::uint8_t, 2'500>;
+
+		room_state() = default;
+		explicit room_state(const room_callback_result_type& result) {
+			std::visit(
+				util::overloaded{
+					[](std::monostate /*undefined*/) -> void {},
+					[ & ](bool allowed) -> void { blocked_ = !allowed; },
+					[ & ](std::span<const std::uint8_t> matrix) -> void {
+						if (matrix.size() == 2'500) {
+							matrix_ = matrix;
+						}
+					},
+				},
+				result
+			);
+		}
+		explicit room_state(const stored_matrix& stored) :
+				version_{stored.version} {}
+
+		auto operator==(const room_state& right) const -> bool {
+			return blocked_ == right.blocked_ && version_ == right.version_ && std::ranges::equal(matrix_, right.matrix_);
+		}
+
+		// Copy of this state which owns its matrix, for keeping in the cache
+		[[nodiscard]] auto owned() const -> room_state {
+			auto copy = *this;
+			if (!matrix_.empty() && owned_ == nullptr) {
+				auto matrix = std::make_shared<matrix_type>();
+				std::ranges::copy(matrix_, matrix->begin());
+				copy.matrix_ = *matrix;
+				copy.owned_ = std::move(matrix);
+			}
+			return copy;
+		}
+
+		// Memory held by this state
+		[[nodiscard]] auto bytes() const -> std::size_t {
+			return sizeof(room_state) + (owned_ == nullptr ? 0 : sizeof(matrix_type));
+		}
+
+	private:
+		std::span<const std::uint8_t> matrix_;
+		std::shared_ptr<const matrix_type> owned_;
+		std::uint64_t version_{};
+		bool blocked_{};
+};
+
+// Memoizes room callback results for a batch of searches. Cost matrices are copied since the
+// originals may be collected before the batch is done.
+export class room_callback_cache {
+	public:
+		// Results known ahead of time, which are used instead of invoking the callback. These are not
+		// copied, so the matrices must outlive the cache.
+		auto preload(const std::vector<room_matrix>& matrices) -> void {
+			for (const auto& entry : matrices) {
+				preloaded_.insert_or_assign(entry.room, entry.matrix);
+			}
+		}
+
+		// Matrices of `variant` in `store`, which are used after preloaded results and before invoking
+		// the callback
+		auto attach(std::shared_ptr<const matrix_store> store, int variant) -> void {
+			store_ = std::move(store);
+			variant_ = variant;
+		}
+
+		auto operator()(room_location_t room, auto&& callback) -> room_callback_result_type {
+			auto entry = results_.find(room);
+			if (entry != results_.end()) {
+				return entry->second;
+			}
+			if (auto preloaded = preloaded_.find(room); preloaded != preloaded_.end()) {
+				auto result = preloaded->second ? room_callback_result_type{*preloaded->second} : room_callback_result_type{false};
+				results_.emplace(room, result);
+				return result;
+			}
+			if (auto stored = store_ ? store_->find(variant_, room) : nullptr) {
+				auto result = stored->costs ? room_callback_result_type{std::span<const std::uint8_t>{*stored->costs}} : room_callback_result_type{false};
+				results_.emplace(room, result);
+				// Held until the cache is gone, since the store may replace it
+				stored_.emplace(room, std::move(stored));
+				return result;
+			}
+			auto result = room_callback_result_type{callback(room)};
+			if (const auto* matrix = std::get_if<std::span<const std::uint8_t>>(&result); matrix != nullptr && matrix->size() == 2'500) {
+				auto& copy = matrices_.emplace_back();
+				std::ranges::copy(*matrix, copy.begin());
+				result = std::span<const std::uint8_t>{copy};
+			}
+			results_.emplace(room, result);
+			return result;
+		}
+
+		// Every room resolved so far, and its result
+		[[nodiscard]] auto results() const -> const auto& { return results_; }
+
+		// What a search saw of a resolved room, for `path_cache`. Stored matrices are identified by
+		// version instead of by content.
+		[[nodiscard]] auto state(room_location_t room) const -> room_state {
+			if (auto stored = stored_.find(room); stored != stored_.end()) {
+				return room_state{*stored->second};
+			}
+			return room_state{results_.at(room)};
+		}
+
+	private:
+		std::unordered_map<room_location_t, room_callback_result_type, room_location_t::hash> results_;
+		std::unordered_map<room_location_t, std::optional<std::span<const std::uint8_t>>, room_location_t::hash> preloaded_;
+		std::unordered_map<room_location_t, matrix_store::entry_type, room_location_t::hash> stored_;
+		std::shared_ptr<const matrix_store> store_;
+		int variant_{};
+		std::deque<std::array<std::uint8_t, 2'500>> matrices_;
+};
+
+// Room callback which reads matrices resolved ahead of time, so that searches may run off the
+// JavaScript thread. Rooms which are not listed use plain terrain.
+export class static_room_callback {
+	public:
+		using matrices_type = std::unordered_map<room_location_t, std::optional<std::span<const std::uint8_t>>, room_location_t::hash>;
+
+		explicit static_room_callback(const matrices_type& matrices) :
+				matrices_{&matrices} {}
+
+		auto operator()(room_location_t room) const -> room_callback_result_type {
+			auto entry = matrices_->find(room);
+			if (entry == matrices_->end()) {
+				return std::monostate{};
+			} else if (entry->second) {
+				return *entry->second;
+			} else {
+				return false;
+			}
+		}
+
+	private:
+		const matrices_type* matrices_;
+};
 
 // sentinel_path_iterator
 struct sentinel_path_iterator {
@@ -71,15 +315,26 @@ class path_iterator : public util::incrementable_facade {
 
 		explicit constexpr path_iterator(sentinel_path_iterator /*sentinel*/) :
 				rooms_{nullptr},
-				parents_{nullptr},
+				parents_{},
 				index_{sentinel_pos_index} {}
 
-		constexpr path_iterator(const auto& rooms, const pos_index_t* parents, pos_index_t index) :
+		constexpr path_iterator(const auto& rooms, strided_pointer<const pos_index_t, 0> parents, pos_index_t index) :
 				rooms_{rooms.data()},
 				parents_{parents},
 				index_{index} {}
 
-		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		// Relinks the goal-side half of a bidirectional search onto `parents`, so the path can be walked
+		// from the goal back through `meeting` to the origin. Returns the new starting index.
+		constexpr static auto splice(auto parents, auto reverse_parents, pos_index_t meeting) -> pos_index_t {
+			auto previous = meeting;
+			for (auto index = reverse_parents[ *meeting ]; index != sentinel_pos_index;) {
+				auto next = reverse_parents[ *index ];
+				parents[ *index ] = previous;
+				previous = std::exchange(index, next);
+			}
+			return previous;
+		}
+
 		constexpr auto operator++() -> auto& { return (index_ = parents_[ *index_ ], *this); }
 		constexpr auto operator==(const path_iterator& right) const -> bool { return index_ == right.index_; }
 		// NOLINTNEXTLINE(cppcoreguidelines-slicing)
@@ -87,7 +342,7 @@ class path_iterator : public util::incrementable_facade {
 
 	private:
 		indexed_position_t::room_table_type rooms_;
-		const pos_index_t* parents_;
+		strided_pointer<const pos_index_t, 0> parents_;
 		pos_index_t index_;
 };
 
@@ -100,6 +355,8 @@ export struct result {
 		int cost{};
 		int ops{};
 		bool incomplete{};
+		// The search ran out of `max_time`. Not offered to JS.
+		bool timed_out{};
 
 		constexpr static auto struct_template = js::struct_template{
 			js::struct_member{util::cw<"cost">, &result::cost},
@@ -109,6 +366,96 @@ export struct result {
 		};
 };
 
+// Result of one `searchMany` query. The path is copied out since the next query reuses the node
+// state.
+export struct batch_result {
+		std::vector<world_position_t> path;
+		int cost{};
+		int ops{};
+		bool incomplete{};
+
+		constexpr static auto struct_template = js::struct_template{
+			js::struct_member{util::cw<"cost">, &batch_result::cost},
+			js::struct_member{util::cw<"incomplete">, &batch_result::incomplete},
+			js::struct_member{util::cw<"ops">, &batch_result::ops},
+			js::struct_member{util::cw<"path">, &batch_result::path},
+		};
+};
+
+// Result of `searchPacked`. The path itself is written to the caller's buffers.
+export struct packed_result {
+		int cost{};
+		int length{};
+		int ops{};
+		bool incomplete{};
+
+		constexpr static auto struct_template = js::struct_template{
+			js::struct_member{util::cw<"cost">, &packed_result::cost},
+			js::struct_member{util::cw<"incomplete">, &packed_result::incomplete},
+			js::struct_member{util::cw<"length">, &packed_result::length},
+			js::struct_member{util::cw<"ops">, &packed_result::ops},
+		};
+};
+
+// Expands a path of jump points, ordered from the goal back to the origin as `result::path` is, into
+// every tile after the origin in forward order. Writes packed world positions and, if `directions`
+// isn't empty, the 1-based direction constant of each step. Returns the number of tiles, which are
+// only written as far as the buffers reach.
+export auto write_path(const auto& path, std::span<std::int32_t> positions, std::span<std::uint8_t> directions) -> int {
+	// Index by `(dy + 1) * 3 + dx + 1`. TOP is 1 and the rest follow clockwise.
+	constexpr auto k_directions = std::array<std::uint8_t, 9>{8, 1, 2, 7, 0, 3, 6, 5, 4};
+
+	// Each straight segment is as long as its Chebyshev distance, so the total is known upfront and
+	// tiles can be written back to front while walking from the goal
+	auto length = 0;
+	auto previous = std::optional<world_position_t>{};
+	for (auto pos : path) {
+		if (previous) {
+			length += previous->range_to(pos);
+		}
+		previous = pos;
+	}
+
+	auto index = length;
+	previous.reset();
+	for (auto pos : path) {
+		if (previous) {
+			auto dx = sign(previous->xx - pos.xx);
+			auto dy = sign(previous->yy - pos.yy);
+			auto direction = k_directions[ ((dy + 1) * 3) + dx + 1 ];
+			for (auto tile = *previous; tile != pos; tile = {tile.xx - dx, tile.yy - dy}) {
+				auto ii = static_cast<std::size_t>(--index);
+				if (ii < positions.size()) {
+					positions[ ii ] = std::bit_cast<std::int32_t>(packed_position{tile});
+				}
+				if (ii < directions.size()) {
+					directions[ ii ] = direction;
+				}
+			}
+		}
+		previous = pos;
+	}
+	return length;
+}
+
+// Result of one `resumeSearch` call. `done` is false if the search ran out of ops and may be
+// resumed, in which case the path leads to the closest node found so far.
+export struct search_progress {
+		std::vector<world_position_t> path;
+		int cost{};
+		int ops{};
+		bool incomplete{};
+		bool done{};
+
+		constexpr static auto struct_template = js::struct_template{
+			js::struct_member{util::cw<"cost">, &search_progress::cost},
+			js::struct_member{util::cw<"done">, &search_progress::done},
+			js::struct_member{util::cw<"incomplete">, &search_progress::incomplete},
+			js::struct_member{util::cw<"ops">, &search_progress::ops},
+			js::struct_member{util::cw<"path">, &search_progress::path},
+		};
+};
+
 // Heap node type. `score` must be checked against `scores` to ensure it is not stale.
 struct heap_node {
 		constexpr auto operator==(const heap_node& right) const -> bool = default;
@@ -116,23 +463,164 @@ struct heap_node {
 		cost_t score;
 };
 
-// Big state arrays that are allocated once upfront and then reused for all iterations
-template <std::size_t RoomCapacity>
+// Heap node which also carries the weighted heuristic part of `score`, for queues that break ties
+struct ranked_heap_node {
+		constexpr auto operator==(const ranked_heap_node& right) const -> bool = default;
+		pos_index_t pos;
+		cost_t score;
+		cost_t h_cost;
+};
+
+// Makes the heap entry for a node, with the heuristic cost if the heap's node type has room for it
+template <class Type>
+constexpr auto make_heap_node(pos_index_t pos, cost_t score, cost_t h_cost) -> Type {
+	if constexpr (requires { &Type::h_cost; }) {
+		return Type{.pos = pos, .score = score, .h_cost = h_cost};
+	} else {
+		return Type{.pos = pos, .score = score};
+	}
+}
+
+// Open list policy: Dial's buckets with a binary heap fallback, nodes in a bucket pop LIFO
+struct bucket_queue {
+		using projection = decltype([](const heap_node& node) { return node.score; });
+		template <std::size_t Capacity>
+		using heap_type = bucket_heap_t<heap_node, projection, Capacity / 8>;
+};
+
+// Open list policy: monotone radix heap
+struct radix_queue {
+		using projection = decltype([](const heap_node& node) { return node.score; });
+		template <std::size_t Capacity>
+		using heap_type = radix_heap_t<heap_node, projection, Capacity / 8>;
+};
+
+// Open list policy: Dial's buckets ordered by (f, h), so that ties pop the node nearest the goal
+struct tiebreak_queue {
+		using projection = decltype([](const ranked_heap_node& node) { return node.score; });
+		using tiebreak = decltype([](const ranked_heap_node& node) { return node.h_cost; });
+		template <std::size_t Capacity>
+		using heap_type = tiebreak_bucket_heap_t<ranked_heap_node, projection, tiebreak, Capacity / 8>;
+};
+
+// Node state layout with one array per field
+struct split_nodes {
+		using parent_pointer = strided_pointer<pos_index_t>;
+		using score_pointer = strided_pointer<cost_t>;
+		using open_closed_view = screeps::open_closed_view;
+
+		template <std::size_t Capacity>
+		class storage {
+			public:
+				auto parents() -> parent_pointer { return parent_pointer{parents_.data()}; }
+				auto scores() -> score_pointer { return score_pointer{scores_.data()}; }
+				auto clear_and_make_view() -> open_closed_view {
+					return next_open_closed_view(open_closed_view::list_type{markers_.data()}, Capacity, marker_);
+				}
+				auto release_from(std::size_t index) -> void {
+					parents_.release_from(index);
+					scores_.release_from(index);
+					markers_.release_from(index);
+				}
+
+			private:
+				reserved_array<pos_index_t> parents_{Capacity};
+				reserved_array<cost_t> scores_{Capacity};
+				reserved_array<open_closed_view::value_type> markers_{Capacity};
+				open_closed_view::value_type marker_ = 1;
+		};
+};
+
+// Node state layout with one record per node, so that `push_node` and `make_iterate` touch one
+// cache line per node instead of three
+struct interleaved_nodes {
+		struct record {
+				pos_index_t parent;
+				cost_t score;
+				screeps::open_closed_view::value_type marker;
+		};
+		using parent_pointer = strided_pointer<pos_index_t, sizeof(record)>;
+		using score_pointer = strided_pointer<cost_t, sizeof(record)>;
+		using open_closed_view = basic_open_closed_view<sizeof(record)>;
+
+		template <std::size_t Capacity>
+		class storage {
+			public:
+				auto parents() -> parent_pointer { return parent_pointer{&records_[ 0 ].parent}; }
+				auto scores() -> score_pointer { return score_pointer{&records_[ 0 ].score}; }
+				auto clear_and_make_view() -> open_closed_view {
+					return next_open_closed_view(open_closed_view::list_type{&records_[ 0 ].marker}, Capacity, marker_);
+				}
+				auto release_from(std::size_t index) -> void { records_.release_from(index); }
+
+			private:
+				reserved_array<record> records_{Capacity};
+				open_closed_view::value_type marker_ = 1;
+		};
+};
+
+// Layout used by every search. Build with `PATHFINDER_INTERLEAVED_NODES` to compare the two with
+// driver/pathfinder/profile.ts.
+#ifdef PATHFINDER_INTERLEAVED_NODES
+using default_nodes = interleaved_nodes;
+#else
+using default_nodes = split_nodes;
+#endif
+
+// Open list used by every search, selected by the `PATHFINDER_QUEUE` CMake option
+#if defined(PATHFINDER_QUEUE_RADIX)
+using default_queue = radix_queue;
+#elif defined(PATHFINDER_QUEUE_TIEBREAK)
+using default_queue = tiebreak_queue;
+#else
+using default_queue = bucket_queue;
+#endif
+
+// Big state arrays that are allocated once upfront and then reused for all iterations. Per-node and
+// per-room arrays are reserved rather than allocated, and each room's page range is only backed by
+// memory once a search opens that many rooms.
+template <std::size_t RoomCapacity, class Nodes = default_nodes, class Queue = default_queue>
 struct instance_state {
 		constexpr static auto search_capacity = k_room_size * RoomCapacity;
 		static_assert(std::numeric_limits<pos_index_t>::max() > search_capacity + k_room_size, "pos_index_t is too small");
 
 		using room_scope_table = scope_table<room_terrain, room_location_t, RoomCapacity>;
-		using open_closed_type = open_closed_t<search_capacity>;
+		using nodes_type = Nodes::template storage<search_capacity>;
+
+		using heap_type = Queue::template heap_type<search_capacity>;
+
+		// Rooms whose pages stay resident between searches
+		constexpr static auto resident_rooms = std::size_t{16};
 
-		using node_projection = decltype([](const heap_node& node) { return node.score; });
-		using heap_type = bucket_heap_t<heap_node, node_projection, search_capacity / 8>;
+		// Clears the room table. If the last search opened more than `resident_rooms` rooms, the pages
+		// of the rooms past those are given back, so that one large search doesn't keep the memory of
+		// every room on this thread. Cleared pages read as zero, which is a valid state for each array.
+		auto clear_rooms() -> void {
+			if (room_table.size() > resident_rooms) {
+				room_grids.release_from(resident_rooms);
+				room_bits.release_from(resident_rooms);
+				nodes.release_from(resident_rooms * k_room_size);
+			}
+			room_table.clear();
+		}
 
 		room_scope_table room_table;
-		std::array<pos_index_t, search_capacity> parents;
-		std::array<cost_t, search_capacity> scores;
-		open_closed_type open_closed;
+		// Indexed by room index - 1, written when each room is opened
+		reserved_array<room_grid_type> room_grids{RoomCapacity};
+		reserved_array<jump_bits_t> room_bits{RoomCapacity};
+		nodes_type nodes;
 		heap_type heap;
+		search_stats stats;
+};
+
+// Node state for the goal frontier of a bidirectional search. Shares the room table with the
+// origin frontier in `instance_state` so that position indices are interchangeable.
+template <std::size_t RoomCapacity>
+struct reverse_state {
+		using state_type = instance_state<RoomCapacity>;
+
+		typename state_type::nodes_type nodes;
+		typename state_type::heap_type heap;
 };
 
 // Provides operations for pathfinder terrain look
@@ -143,36 +631,111 @@ struct look_delegate {
 		auto look_open(world_position_t pos) -> std::pair<room_index_t, cost_t>;
 		auto room_index_from_location(room_location_t location) -> room_index_t;
 		[[nodiscard]] auto index_from_pos(world_position_t pos) const -> indexed_position_t;
+		[[nodiscard]] auto jump_table(indexed_position_t pos) const -> const jump_table_t*;
+		[[nodiscard]] auto jump_bits(indexed_position_t pos) const -> const jump_bits_t&;
 
 		unsigned max_rooms{};
 		terrain_cost_type look_table{};
 		Callback room_callback;
 		std::reference_wrapper<blocked_rooms_type> blocked_rooms;
 		std::reference_wrapper<RoomTable> room_table;
+		room_grid_type* room_grids{};
+		jump_bits_t* room_bits{};
+		// Counters of the running search, shared by both frontiers of a bidirectional search
+		std::reference_wrapper<search_stats> stats;
+		// When set, rooms outside of this set are not searched
+		const blocked_rooms_type* corridor{};
+		// When set, the room table is shared with earlier searches of a batch
+		admitted_rooms* admitted{};
 };
 
-// Provides `parent_of` and `push_node`
-template <class Heap>
+// Provides `parent_of` and `push_node`. `Heuristic` may be a `heuristic_t::specialized`.
+template <class Heap, class Heuristic = heuristic_t, class Nodes = default_nodes>
 struct node_delegate {
 		auto parent_of(this auto& self, pos_index_t index) -> indexed_position_t;
-		auto push_node(indexed_position_t node, pos_index_t parent_index, cost_t g_cost) -> void;
+		auto push_node(this auto& self, indexed_position_t node, pos_index_t parent_index, cost_t g_cost) -> void;
 
-		heuristic_t heuristic;
+		Heuristic heuristic;
 		double heuristic_weight{};
-		open_closed_view open_closed;
-		cost_t* scores{};
-		pos_index_t* parents{};
+		typename Nodes::open_closed_view open_closed;
+		typename Nodes::score_pointer scores;
+		typename Nodes::parent_pointer parents;
 		std::reference_wrapper<Heap> heap;
 };
 
+// Cheapest known node which has been reached by both frontiers of a bidirectional search
+struct meeting_t {
+		cost_t cost = std::numeric_limits<cost_t>::max();
+		pos_index_t index = sentinel_pos_index;
+};
+
+// `node_delegate` for one frontier of a bidirectional search. Each time a node is labeled it is
+// checked against the opposite frontier for a cheaper meeting point.
+template <class Heap>
+struct meeting_delegate : node_delegate<Heap> {
+		auto push_node(this auto& self, indexed_position_t node, pos_index_t parent_index, cost_t g_cost) -> void;
+
+		const node_delegate<Heap>* opposite{};
+		std::reference_wrapper<meeting_t> meeting;
+};
+
 // Collect everything above into an instantiable implementation
 export template <auto Check, class Callback, std::size_t RoomCapacity>
 class pathfinder {
 	public:
 		auto search(Callback room_callback, world_position_t origin, heuristic_t heuristic, const options& options) -> std::optional<result>;
+		auto search_many(Callback room_callback, std::span<const batch_query> queries) -> std::vector<batch_result>;
+		auto distance_field(Callback room_callback, heuristic_t heuristic, const options& options, std::span<std::uint16_t> distances, std::span<std::uint8_t> directions) -> std::vector<room_location_t>;
+
+	private:
+		auto search_tiles(Callback room_callback, world_position_t origin, heuristic_t heuristic, const options& options, const blocked_rooms_type* corridor) -> std::optional<result>;
+		auto search_bidirectional(auto& delegate, world_position_t origin, const heuristic_t::goal_t& goal, const options& options) -> std::optional<result>;
+		auto search_loop(auto& delegate, world_position_t origin, const options& options, cost_t max_cost) -> std::optional<result>;
+
+		std::unique_ptr<instance_state<RoomCapacity>> instance_state_ = std::make_unique_for_overwrite<instance_state<RoomCapacity>>();
+		std::unique_ptr<reverse_state<RoomCapacity>> reverse_state_;
+		// Set by `search_many`, so that queries keep the rooms opened by earlier queries with the same
+		// terrain costs
+		bool batch_{};
+		std::optional<terrain_cost_type> batch_look_table_;
+};
+
+// A search which keeps its heap, open/closed list and parents between calls, so that it can stop
+// when its ops budget runs out and continue on a later call. It owns its node state rather than
+// sharing the thread's pathfinder, and rooms are resolved through `rooms()` so that their cost
+// matrices outlive the call which opened them. Only plain forward and flee searches are supported;
+// `bidirectional` and `hierarchical` are ignored.
+export template <auto Check, class Callback, std::size_t RoomCapacity>
+class search_session {
+	public:
+		search_session(world_position_t origin, goals_type goals, bool flee, const options& options);
+		search_session(const search_session&) = delete;
+		search_session(search_session&&) = delete;
+		~search_session() = default;
+		auto operator=(const search_session&) -> search_session& = delete;
+		auto operator=(search_session&&) -> search_session& = delete;
+
+		// Expands up to `max_ops` more nodes. `room_callback` must resolve rooms through `rooms()`.
+		auto resume(Callback room_callback, int max_ops) -> search_progress;
+		auto rooms() -> room_callback_cache& { return rooms_; }
+		[[nodiscard]] auto running() const -> bool { return running_; }
 
 	private:
-		instance_state<RoomCapacity> instance_state_;
+		world_position_t origin_;
+		goals_type goals_;
+		heuristic_t heuristic_;
+		options options_;
+		std::unique_ptr<instance_state<RoomCapacity>> state_ = std::make_unique_for_overwrite<instance_state<RoomCapacity>>();
+		default_nodes::open_closed_view open_closed_;
+		blocked_rooms_type blocked_rooms_;
+		room_callback_cache rooms_;
+		indexed_position_t min_node_;
+		cost_t min_node_g_cost_{};
+		cost_t min_node_h_cost_ = std::numeric_limits<cost_t>::max();
+		int ops_{};
+		bool started_{};
+		bool done_{};
+		bool running_{};
 };
 
 }; // namespace screeps
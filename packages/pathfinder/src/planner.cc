@@ -0,0 +1,311 @@
+export module screeps:planner;
+import :astar;
+import :pf;
+import std;
+import util;
+
+namespace screeps {
+
+// Incremental planner which keeps its search state between calls and repairs it when tile costs
+// change or the origin moves. This is D* Lite: the search runs backward from the goals, so `g` of
+// each tile is its cost to the nearest goal, and `rhs` is the one-step lookahead of `g`. A change
+// only requeues the tiles next to it, and only tiles whose cost to the goal actually changed are
+// expanded again.
+export class planner {
+	private:
+		// Cost to the goal of tiles which have not been reached
+		constexpr static auto infinity = std::numeric_limits<cost_t>::max() / 2;
+
+		using node_type = unsigned;
+		using key_type = std::pair<cost_t, cost_t>;
+		using queue_entry = std::pair<key_type, node_type>;
+
+		struct room_state {
+				room_location_t location;
+				terrain_type terrain{};
+				// Cost of entering each tile by `yy * 50 + xx`, `obstacle` if it can't be entered
+				std::array<std::uint8_t, k_room_size> costs{};
+				std::array<cost_t, k_room_size> g{};
+				std::array<cost_t, k_room_size> rhs{};
+		};
+
+	public:
+		planner(world_position_t origin, std::vector<heuristic_t::goal_t> goals, cost_t plain_cost, cost_t swamp_cost, int max_rooms) :
+				origin_{origin},
+				last_origin_{origin},
+				goals_{std::move(goals)},
+				look_table_{{std::clamp(plain_cost, 1, 0xfe), obstacle, std::clamp(swamp_cost, 1, 0xfe), obstacle}},
+				max_rooms_{static_cast<std::size_t>(std::clamp(max_rooms, 1, static_cast<int>(k_max_rooms)))} {}
+
+		// Applies tile changes, moves the origin and repairs the path. `room_callback` is only invoked
+		// for rooms the planner has not opened yet, so changes in those rooms must be reflected by the
+		// callback instead. The search resumes where it left off if it runs out of ops.
+		template <auto Check, class Callback>
+		auto update(Callback& room_callback, world_position_t origin, std::span<const tile_change> changes, int max_ops) -> batch_result {
+			updating_ = true;
+			auto after = util::scope_exit{[ & ] { updating_ = false; }};
+			auto budget = std::clamp(max_ops, 1, std::numeric_limits<int>::max());
+			auto ops_remaining = budget;
+			auto ops = [ & ] -> int { return budget - ops_remaining; };
+			auto clock = search_clock<Check>{0, 0};
+
+			// Goal tiles are seeded once, when the room callback is first available
+			if (!seeded_) {
+				seeded_ = true;
+				for (const auto& goal : goals_) {
+					for (int dy = -goal.range; dy <= goal.range; ++dy) {
+						for (int dx = -goal.range; dx <= goal.range; ++dx) {
+							if (auto node = node_of(room_callback, {goal.pos.xx + dx, goal.pos.yy + dy})) {
+								rhs(*node) = 0;
+								queue_.emplace(key_of(*node), *node);
+							}
+						}
+					}
+				}
+			}
+
+			// The heuristic is measured from the origin, so queued keys are raised by how far it moved
+			// instead of being recomputed
+			if (origin != origin_) {
+				key_modifier_ += last_origin_.range_to(origin);
+				last_origin_ = origin;
+				origin_ = origin;
+			}
+
+			// Changing a tile changes the cost of every move onto it
+			for (const auto& change : changes) {
+				auto node = find_node(change.pos);
+				if (!node) {
+					continue;
+				}
+				auto& room = rooms_[ *node / k_room_size ];
+				auto local = *node % k_room_size;
+				auto cost = resolve_cost(room.terrain, nullptr, change.pos.xx % 50, change.pos.yy % 50);
+				if (change.cost == 0xff) {
+					cost = obstacle;
+				} else if (change.cost > 0) {
+					cost = std::min(change.cost, 0xfe);
+				}
+				if (room.costs[ local ] == cost) {
+					continue;
+				}
+				room.costs[ local ] = static_cast<std::uint8_t>(cost);
+				for_each_neighbor(room_callback, change.pos, [ & ](world_position_t /*pos*/, node_type neighbor) -> void {
+					update_node(room_callback, neighbor);
+				});
+			}
+
+			// Repair
+			auto origin_node = node_of(room_callback, origin_);
+			if (!origin_node) {
+				return batch_result{.ops = ops(), .incomplete = true};
+			}
+			while (!queue_.empty()) {
+				auto [ key, node ] = queue_.top();
+				if (g(node) == rhs(node)) {
+					queue_.pop();
+					continue;
+				}
+				auto current_key = key_of(node);
+				if (current_key < key) {
+					// This entry was superseded by a cheaper one which has already been expanded
+					queue_.pop();
+					continue;
+				} else if (key < current_key) {
+					// The origin moved since this entry was queued
+					queue_.pop();
+					queue_.emplace(current_key, node);
+					continue;
+				}
+				if (!(key < key_of(*origin_node)) && rhs(*origin_node) == g(*origin_node)) {
+					break;
+				}
+				if (ops_remaining == 0) {
+					return batch_result{.ops = ops(), .incomplete = true};
+				}
+				--ops_remaining;
+				clock();
+				queue_.pop();
+				auto pos = position_of(node);
+				if (g(node) > rhs(node)) {
+					g(node) = rhs(node);
+				} else {
+					g(node) = infinity;
+					update_node(room_callback, node);
+				}
+				for_each_neighbor(room_callback, pos, [ & ](world_position_t /*pos*/, node_type neighbor) -> void {
+					update_node(room_callback, neighbor);
+				});
+			}
+
+			// Walk downhill from the origin
+			auto result = batch_result{.ops = ops()};
+			if (g(*origin_node) >= infinity) {
+				result.incomplete = true;
+				return result;
+			}
+			auto path = std::vector<world_position_t>{origin_};
+			for (std::size_t ii = 0; !is_goal(path.back()) && ii < rooms_.size() * k_room_size; ++ii) {
+				auto best = std::optional<std::pair<world_position_t, node_type>>{};
+				auto best_cost = infinity;
+				for_each_neighbor(room_callback, path.back(), [ & ](world_position_t pos, node_type neighbor) -> void {
+					auto cost = cost_of(neighbor);
+					if (cost != obstacle && cost + g(neighbor) < best_cost) {
+						best = std::pair{pos, neighbor};
+						best_cost = cost + g(neighbor);
+					}
+				});
+				if (!best) {
+					result.incomplete = true;
+					break;
+				}
+				result.cost += cost_of(best->second);
+				path.push_back(best->first);
+			}
+			result.incomplete = result.incomplete || !is_goal(path.back());
+			// Paths run from the goal back to the origin, like `search`
+			std::ranges::reverse(path);
+			result.path = std::move(path);
+			return result;
+		}
+
+		// True while `update` is running, in which case the room callback must not update it again
+		[[nodiscard]] auto updating() const -> bool { return updating_; }
+
+	private:
+		[[nodiscard]] auto g(this auto& self, node_type node) -> auto& {
+			return self.rooms_[ node / k_room_size ].g[ node % k_room_size ];
+		}
+
+		[[nodiscard]] auto rhs(this auto& self, node_type node) -> auto& {
+			return self.rooms_[ node / k_room_size ].rhs[ node % k_room_size ];
+		}
+
+		[[nodiscard]] auto cost_of(node_type node) const -> cost_t {
+			return rooms_[ node / k_room_size ].costs[ node % k_room_size ];
+		}
+
+		[[nodiscard]] auto position_of(node_type node) const -> world_position_t {
+			const auto& room = rooms_[ node / k_room_size ];
+			auto local = static_cast<int>(node % k_room_size);
+			return {(room.location.xx * 50) + (local % 50), (room.location.yy * 50) + (local / 50)};
+		}
+
+		[[nodiscard]] auto is_goal(world_position_t pos) const -> bool {
+			return std::ranges::any_of(goals_, [ & ](const auto& goal) -> bool { return pos.range_to(goal.pos) <= goal.range; });
+		}
+
+		// Chebyshev distance is admissible since every move costs at least 1
+		[[nodiscard]] auto key_of(node_type node) const -> key_type {
+			auto cost = std::min(g(node), rhs(node));
+			return {std::min(cost + position_of(node).range_to(origin_) + key_modifier_, infinity), cost};
+		}
+
+		[[nodiscard]] auto resolve_cost(terrain_type terrain, cost_matrix_type cost_matrix, unsigned xx, unsigned yy) const -> cost_t {
+			return room_terrain{terrain, cost_matrix}(look_table_, xx, yy);
+		}
+
+		// Returns the node of an opened room
+		[[nodiscard]] auto find_node(world_position_t pos) const -> std::optional<node_type> {
+			auto room = room_index_.find(pos.room());
+			if (room == room_index_.end() || !room->second) {
+				return std::nullopt;
+			}
+			return static_cast<node_type>((*room->second * k_room_size) + ((pos.yy % 50) * 50) + (pos.xx % 50));
+		}
+
+		// Returns the node of a position, opening its room if needed and possible
+		auto node_of(auto& room_callback, world_position_t pos) -> std::optional<node_type> {
+			if (pos.xx < 0 || pos.yy < 0 || pos.xx > k_world_edge || pos.yy > k_world_edge) {
+				return std::nullopt;
+			}
+			auto location = pos.room();
+			if (!room_index_.contains(location)) {
+				room_index_.emplace(location, open_room(room_callback, location));
+			}
+			return find_node(pos);
+		}
+
+		auto open_room(auto& room_callback, room_location_t location) -> std::optional<std::size_t> {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			const auto* terrain = terrain_map[ room_id_of(location) ];
+			if (terrain == nullptr || rooms_.size() >= max_rooms_) {
+				return std::nullopt;
+			}
+			auto callback_result = room_callback(location);
+			if (std::holds_alternative<bool>(callback_result) && !std::get<bool>(callback_result)) {
+				return std::nullopt;
+			}
+			constexpr auto unwrap = util::overloaded{
+				[](auto /* undefined_or_true */) -> cost_matrix_type { return nullptr; },
+				[](std::span<const std::uint8_t> data) -> cost_matrix_type {
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+					return data.size() == 2'500 ? reinterpret_cast<cost_matrix_type>(data.data()) : nullptr;
+				},
+			};
+			auto cost_matrix = std::visit(unwrap, callback_result);
+			auto& room = rooms_.emplace_back();
+			room.location = location;
+			room.terrain = terrain;
+			for (unsigned yy = 0; yy < 50; ++yy) {
+				for (unsigned xx = 0; xx < 50; ++xx) {
+					room.costs[ (yy * 50) + xx ] = static_cast<std::uint8_t>(resolve_cost(terrain, cost_matrix, xx, yy));
+				}
+			}
+			std::ranges::fill(room.g, infinity);
+			std::ranges::fill(room.rhs, infinity);
+			return rooms_.size() - 1;
+		}
+
+		// Invokes `fn` for each tile which can be reached in one move from `pos`. Moves are symmetric
+		// so these are also the tiles which can reach `pos`.
+		auto for_each_neighbor(auto& room_callback, world_position_t pos, auto fn) -> void {
+			for (auto dir : contiguous_enum_range(direction_t::TOP, direction_t::TOP_LEFT)) {
+				auto neighbor = pos.position_in_direction(dir);
+				if (!is_possible_move(pos, neighbor)) {
+					continue;
+				}
+				if (auto node = node_of(room_callback, neighbor)) {
+					fn(neighbor, *node);
+				}
+			}
+		}
+
+		// Recomputes the lookahead of one node and queues it if it is inconsistent
+		auto update_node(auto& room_callback, node_type node) -> void {
+			auto pos = position_of(node);
+			if (!is_goal(pos) || cost_of(node) == obstacle) {
+				auto best = infinity;
+				for_each_neighbor(room_callback, pos, [ & ](world_position_t /*pos*/, node_type neighbor) -> void {
+					auto cost = cost_of(neighbor);
+					if (cost != obstacle) {
+						best = std::min(best, cost + g(neighbor));
+					}
+				});
+				rhs(node) = std::min(best, infinity);
+			}
+			if (g(node) != rhs(node)) {
+				queue_.emplace(key_of(node), node);
+			}
+		}
+
+		world_position_t origin_;
+		world_position_t last_origin_;
+		std::vector<heuristic_t::goal_t> goals_;
+		terrain_cost_type look_table_;
+		std::size_t max_rooms_;
+		cost_t key_modifier_{};
+		bool seeded_{};
+		bool updating_{};
+		std::deque<room_state> rooms_;
+		std::unordered_map<room_location_t, std::optional<std::size_t>, room_location_t::hash> room_index_;
+		std::priority_queue<queue_entry, std::vector<queue_entry>, std::greater<>> queue_;
+};
+
+// Planners outlive the call that made them, so they are kept here and referred to by handle
+export auto planners() -> handle_registry<planner>& {
+	static handle_registry<planner> registry;
+	return registry;
+}
+
+} // namespace screeps
@@ -0,0 +1,93 @@
+export module screeps:pool;
+import std;
+
+namespace screeps {
+
+// Fixed set of threads which help run jobs. Each job also runs on its calling thread, and idle
+// workers join queued jobs until each has been picked up by every worker or has finished, so
+// batches from several threads share the pool. Jobs are expected to split up their own work, so that
+// a job returns once all of it has been claimed.
+export class worker_pool {
+	public:
+		explicit worker_pool(unsigned workers) {
+			threads_.reserve(workers);
+			for (unsigned ii = 0; ii < workers; ++ii) {
+				threads_.emplace_back([ this ](const std::stop_token& stop) { work(stop); });
+			}
+		}
+
+		worker_pool(const worker_pool&) = delete;
+		worker_pool(worker_pool&&) = delete;
+		~worker_pool() {
+			for (auto& thread : threads_) {
+				thread.request_stop();
+			}
+		}
+		auto operator=(const worker_pool&) -> worker_pool& = delete;
+		auto operator=(worker_pool&&) -> worker_pool& = delete;
+
+		[[nodiscard]] auto size() const -> std::size_t { return threads_.size(); }
+
+		// Runs `job` on the calling thread and on any workers which are free, and returns once every
+		// copy is done. `job` must not throw.
+		auto run(const std::function<void()>& job) -> void {
+			if (threads_.empty()) {
+				job();
+				return;
+			}
+			auto entry = queued_job{.job = &job, .slots = threads_.size()};
+			{
+				std::lock_guard lock{mutex_};
+				queue_.push_back(&entry);
+			}
+			wake_.notify_all();
+			job();
+			// All work is claimed now, so workers which haven't joined yet don't need to
+			std::unique_lock lock{mutex_};
+			if (auto found = std::ranges::find(queue_, &entry); found != queue_.end()) {
+				queue_.erase(found);
+			}
+			done_.wait(lock, [ & ] { return entry.active == 0; });
+		}
+
+	private:
+		struct queued_job {
+				const std::function<void()>* job;
+				// Workers which may still join, and workers running the job
+				std::size_t slots;
+				std::size_t active{};
+		};
+
+		auto work(const std::stop_token& stop) -> void {
+			while (true) {
+				queued_job* entry{};
+				{
+					std::unique_lock lock{mutex_};
+					if (!wake_.wait(lock, stop, [ & ] { return !queue_.empty(); })) {
+						return;
+					}
+					entry = queue_.front();
+					++entry->active;
+					if (--entry->slots == 0) {
+						queue_.pop_front();
+					}
+				}
+				(*entry->job)();
+				{
+					std::lock_guard lock{mutex_};
+					--entry->active;
+				}
+				done_.notify_all();
+			}
+		}
+
+		std::mutex mutex_;
+		std::condition_variable_any wake_;
+		std::condition_variable done_;
+		// Jobs are owned by the threads which called `run`
+		std::deque<queued_job*> queue_;
+		// Declared last so that threads are joined before the state above goes away
+		std::vector<std::jthread> threads_;
+};
+
+} // namespace screeps
@@ -91,7 +91,7 @@ export struct world_position_t {
 			auto dx = sign(pos.xx - xx) + 1;
 			auto dy = sign(pos.yy - yy) + 1;
 			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
-			return delta[ dx ][ dy ];
+			return delta[ dy ][ dx ];
 		}
 
 		[[nodiscard]] constexpr auto range_to(world_position_t pos) const -> int {
@@ -111,6 +111,32 @@ export struct world_position_t {
 		alignas(std::ptrdiff_t) int yy{};
 };
 
+// Portal nodes (room borders) restrict which moves are possible, these should be discarded
+constexpr auto is_possible_move(const world_position_t& pos, const world_position_t& neighbor) -> bool {
+	if (pos.xx % 50 == 0) {
+		return !(
+			(neighbor.xx % 50 == 49 && pos.yy != neighbor.yy) ||
+			pos.xx == neighbor.xx
+		);
+	} else if (pos.xx % 50 == 49) {
+		return !(
+			(neighbor.xx % 50 == 0 && pos.yy != neighbor.yy) ||
+			pos.xx == neighbor.xx
+		);
+	} else if (pos.yy % 50 == 0) {
+		return !(
+			(neighbor.yy % 50 == 49 && pos.xx != neighbor.xx) ||
+			pos.yy == neighbor.yy
+		);
+	} else if (pos.yy % 50 == 49) {
+		return !(
+			(neighbor.yy % 50 == 0 && pos.xx != neighbor.xx) ||
+			pos.yy == neighbor.yy
+		);
+	}
+	return true;
+}
+
 // World position which also carries around room index
 struct indexed_position_t : public world_position_t {
 		using room_table_type = const std::pair<room_location_t, room_terrain>*;
@@ -24,6 +24,10 @@ constexpr auto obstacle = cost_t{0};
 // Table of terrain costs [ plain, swamp, wall, [??] ]
 using terrain_cost_type = std::array<cost_t, 4>;
 
+// Row-major move costs of a room with terrain and cost matrix already applied. Costs are clamped to
+// 0xfe so they fit in a byte.
+using room_grid_type = std::array<std::uint8_t, 2500>;
+
 // Stores coordinates of a room on the global world map.
 // For instance, "E1N1" -> { xx: 129, yy: 126 } -- this is implemented in JS
 export struct room_location_t {
@@ -60,6 +64,33 @@ struct room_terrain {
 			}
 		}
 
+		[[nodiscard]] constexpr auto has_cost_matrix() const -> bool { return cost_matrix_ != nullptr; }
+
+		// Writes the cost of every tile to `grid`, so that searches can look them up with a single load
+		constexpr auto resolve(const terrain_cost_type& costs, room_grid_type& grid) const -> void {
+			auto lanes = std::array<std::uint8_t, 4>{};
+			std::ranges::transform(costs, lanes.begin(), [](cost_t cost) { return static_cast<std::uint8_t>(cost); });
+			for (unsigned ii = 0; ii < 625; ++ii) {
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				auto packed = unsigned{terrain_[ ii ]};
+				for (unsigned jj = 0; jj < 4; ++jj) {
+					// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+					grid[ (ii * 4) + jj ] = lanes[ (packed >> (jj * 2)) & 0x03 ];
+				}
+			}
+			if (cost_matrix_ != nullptr) {
+				// The matrix is column-major, so this transposes it as it goes
+				for (unsigned xx = 0; xx < 50; ++xx) {
+					for (unsigned yy = 0; yy < 50; ++yy) {
+						// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+						auto cost = cost_matrix_[ xx ][ yy ];
+						auto& tile = grid[ (yy * 50) + xx ];
+						tile = cost == 0 ? tile : cost == 255 ? std::uint8_t{obstacle} : cost;
+					}
+				}
+			}
+		}
+
 	private:
 		[[nodiscard]] constexpr auto terrain_look(const terrain_cost_type& costs, unsigned xx, unsigned yy) const -> cost_t {
 			auto index = (yy * 50) + xx;
@@ -0,0 +1,255 @@
+export module screeps:route;
+import :hierarchy;
+import :open_closed;
+import :position;
+import :room;
+import :terrain;
+import std;
+
+namespace screeps {
+
+using room_set_type = std::unordered_set<room_location_t, room_location_t::hash>;
+
+// Scratch state for `find_route`, allocated once per thread
+struct route_state {
+		open_closed_t<map_position_size> open_closed;
+		std::array<double, map_position_size> scores;
+		std::array<room_location_t, map_position_size> parents;
+};
+thread_local std::unique_ptr<route_state> route_state_;
+
+// A* over rooms connected by the exits derived in `load_terrain`. Entering a room costs 1 unless an
+// override is given in `costs`, which is a flat list of `[ roomId, cost, ... ]` pairs. Negative and
+// infinite costs block the room. Returns the list of rooms after `origin`, up to and including
+// `destination`.
+export auto find_route(
+	room_location_t origin,
+	room_location_t destination,
+	std::optional<std::span<const double>> costs
+) -> std::optional<std::vector<room_location_t>> {
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+	if (terrain_map[ room_id_of(origin) ] == nullptr || terrain_map[ room_id_of(destination) ] == nullptr) {
+		return std::nullopt;
+	} else if (origin == destination) {
+		return std::vector<room_location_t>{};
+	}
+
+	// Collect cost overrides. The heuristic is scaled down by the cheapest room so that it stays
+	// admissible.
+	auto overrides = std::unordered_map<room_location_t, double, room_location_t::hash>{};
+	auto min_cost = 1.;
+	if (costs) {
+		for (std::size_t ii = 0; ii + 1 < costs->size(); ii += 2) {
+			auto room = std::bit_cast<room_location_t>(static_cast<std::uint16_t>((*costs)[ ii ]));
+			auto cost = (*costs)[ ii + 1 ];
+			overrides.insert_or_assign(room, cost);
+			if (cost >= 0 && !std::isinf(cost)) {
+				min_cost = std::min(min_cost, cost);
+			}
+		}
+	}
+	const auto heuristic = [ & ](room_location_t room) -> double {
+		return (std::abs(room.xx - destination.xx) + std::abs(room.yy - destination.yy)) * min_cost;
+	};
+
+	// Reset search state
+	if (route_state_ == nullptr) {
+		route_state_ = std::make_unique<route_state>();
+	}
+	auto& state = *route_state_;
+	auto open_closed = state.open_closed.clear_and_make_view();
+	using heap_node = std::pair<double, room_location_t>;
+	constexpr auto compare = [](const heap_node& left, const heap_node& right) -> bool { return left.first > right.first; };
+	auto heap = std::priority_queue<heap_node, std::vector<heap_node>, decltype(compare)>{compare};
+	open_closed.open(room_id_of(origin));
+	state.scores[ room_id_of(origin) ] = 0;
+	heap.emplace(heuristic(origin), origin);
+
+	constexpr auto neighbors = std::array{
+		std::tuple{k_exit_top, k_exit_bottom, 0, -1},
+		std::tuple{k_exit_right, k_exit_left, 1, 0},
+		std::tuple{k_exit_bottom, k_exit_top, 0, 1},
+		std::tuple{k_exit_left, k_exit_right, -1, 0},
+	};
+	while (!heap.empty()) {
+		auto room = heap.top().second;
+		heap.pop();
+		if (open_closed.is_closed(room_id_of(room))) {
+			continue;
+		}
+		open_closed.close(room_id_of(room));
+
+		if (room == destination) {
+			// Walk back to the origin
+			auto route = std::vector<room_location_t>{};
+			for (auto current = room; current != origin; current = state.parents[ room_id_of(current) ]) {
+				route.push_back(current);
+			}
+			std::ranges::reverse(route);
+			return route;
+		}
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		auto exits = room_exits[ room_id_of(room) ];
+		auto g_cost = state.scores[ room_id_of(room) ];
+		for (auto [ exit, entrance, dx, dy ] : neighbors) {
+			int xx = room.xx + dx;
+			int yy = room.yy + dy;
+			if ((exits & exit) == 0 || xx < 0 || xx > 0xff || yy < 0 || yy > 0xff) {
+				continue;
+			}
+			auto next = room_location_t{static_cast<std::uint8_t>(xx), static_cast<std::uint8_t>(yy)};
+			auto next_id = room_id_of(next);
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			if (open_closed.is_closed(next_id) || terrain_map[ next_id ] == nullptr || (room_exits[ next_id ] & entrance) == 0) {
+				continue;
+			}
+			auto cost = [ & ] {
+				auto entry = overrides.find(next);
+				return entry == overrides.end() ? 1. : entry->second;
+			}();
+			if (!(cost >= 0) || std::isinf(cost)) {
+				continue;
+			}
+			auto next_g_cost = g_cost + cost;
+			if (!open_closed.is_open(next_id) || next_g_cost < state.scores[ next_id ]) {
+				open_closed.open(next_id);
+				state.scores[ next_id ] = next_g_cost;
+				state.parents[ next_id ] = room;
+				heap.emplace(next_g_cost + heuristic(next), next);
+			}
+		}
+	}
+	return std::nullopt;
+}
+
+// Plans a path from `origin` to `goal` over the room entrances and distances built by
+// `load_terrain`. Returns the rooms which the planned path passes through.
+export auto plan_corridor(world_position_t origin, world_position_t goal) -> std::optional<room_set_type> {
+	auto origin_room = origin.room();
+	auto goal_room = goal.room();
+	if (origin_room == goal_room || room_graphs(origin_room) == nullptr || room_graphs(goal_room) == nullptr) {
+		return std::nullopt;
+	}
+
+	// Terrain distances within the first and last rooms
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+	auto origin_distances = room_distances(terrain_map[ room_id_of(origin_room) ], origin.xx % 50, origin.yy % 50);
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+	auto goal_distances = room_distances(terrain_map[ room_id_of(goal_room) ], goal.xx % 50, goal.yy % 50);
+	const auto distance_to = [](const room_distances_type& distances, const entrance_t& entrance) -> cost_t {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		return distances[ (entrance.yy() * 50) + entrance.xx() ];
+	};
+
+	// Abstract nodes are keyed by room and entrance index. The goal is one extra node.
+	using node_key = std::uint32_t;
+	constexpr auto sentinel_key = std::numeric_limits<node_key>::max();
+	constexpr auto goal_key = sentinel_key - 1;
+	constexpr auto make_key = [](room_location_t room, std::size_t entrance) -> node_key {
+		return (node_key{room_id_of(room)} << 8) | static_cast<node_key>(entrance);
+	};
+	constexpr auto room_of = [](node_key key) -> room_location_t {
+		return std::bit_cast<room_location_t>(static_cast<std::uint16_t>(key >> 8));
+	};
+	struct node_state {
+			cost_t g_cost;
+			node_key parent;
+			bool closed;
+	};
+	auto nodes = std::unordered_map<node_key, node_state>{};
+	using heap_node = std::tuple<cost_t, cost_t, node_key>;
+	auto heap = std::priority_queue<heap_node, std::vector<heap_node>, std::greater<>>{};
+	const auto push = [ & ](node_key key, world_position_t pos, cost_t g_cost, node_key parent) -> void {
+		auto& node = nodes.try_emplace(key, node_state{.g_cost = unreachable, .parent = sentinel_key, .closed = false}).first->second;
+		if (!node.closed && g_cost < node.g_cost) {
+			node = {.g_cost = g_cost, .parent = parent, .closed = false};
+			heap.emplace(g_cost + pos.range_to(goal), g_cost, key);
+		}
+	};
+	const auto push_entrance = [ & ](room_location_t room, std::size_t index, const entrance_t& entrance, cost_t g_cost, node_key parent) -> void {
+		auto pos = world_position_t{static_cast<int>((room.xx * 50) + entrance.xx()), static_cast<int>((room.yy * 50) + entrance.yy())};
+		push(make_key(room, index), pos, g_cost, parent);
+	};
+
+	// Start from each entrance reachable from the origin
+	{
+		const auto& graph = *room_graphs(origin_room);
+		for (std::size_t ii = 0; ii < graph.entrances.size(); ++ii) {
+			auto distance = distance_to(origin_distances, graph.entrances[ ii ]);
+			if (distance != unreachable) {
+				push_entrance(origin_room, ii, graph.entrances[ ii ], distance, sentinel_key);
+			}
+		}
+	}
+
+	constexpr auto crossings = std::array{
+		std::tuple{room_side::bottom, 0, -1},
+		std::tuple{room_side::left, 1, 0},
+		std::tuple{room_side::top, 0, 1},
+		std::tuple{room_side::right, -1, 0},
+	};
+	while (!heap.empty()) {
+		auto [ f_cost, g_cost, key ] = heap.top();
+		heap.pop();
+		auto& node = nodes[ key ];
+		if (node.closed || node.g_cost != g_cost) {
+			continue;
+		}
+		node.closed = true;
+
+		if (key == goal_key) {
+			// Collect the rooms along the planned path
+			auto corridor = room_set_type{origin_room, goal_room};
+			for (auto current = node.parent; current != sentinel_key; current = nodes[ current ].parent) {
+				corridor.insert(room_of(current));
+			}
+			return corridor;
+		}
+
+		auto room = room_of(key);
+		const auto& graph = *room_graphs(room);
+		auto index = std::size_t{key & 0xff};
+		const auto& entrance = graph.entrances[ index ];
+
+		// Finish inside the goal room
+		if (room == goal_room) {
+			auto distance = distance_to(goal_distances, entrance);
+			if (distance != unreachable) {
+				push(goal_key, goal, g_cost + distance, key);
+			}
+		}
+
+		// Walk to the other entrances of this room
+		for (std::size_t ii = 0; ii < graph.entrances.size(); ++ii) {
+			auto distance = graph.distance(index, ii);
+			if (ii != index && distance != unreachable) {
+				push_entrance(room, ii, graph.entrances[ ii ], g_cost + distance, key);
+			}
+		}
+
+		// Cross into the neighboring room through overlapping entrances on the opposite side
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		auto [ opposite, dx, dy ] = crossings[ static_cast<std::size_t>(entrance.side) ];
+		int xx = room.xx + dx;
+		int yy = room.yy + dy;
+		if (xx < 0 || xx > 0xff || yy < 0 || yy > 0xff) {
+			continue;
+		}
+		auto next_room = room_location_t{static_cast<std::uint8_t>(xx), static_cast<std::uint8_t>(yy)};
+		const auto* next_graph = room_graphs(next_room);
+		if (next_graph == nullptr) {
+			continue;
+		}
+		for (std::size_t ii = 0; ii < next_graph->entrances.size(); ++ii) {
+			const auto& next = next_graph->entrances[ ii ];
+			if (next.side == opposite && next.first <= entrance.last && next.last >= entrance.first) {
+				auto shift = std::abs(static_cast<int>(next.offset()) - static_cast<int>(entrance.offset()));
+				push_entrance(next_room, ii, next, g_cost + std::max(shift, 1), key);
+			}
+		}
+	}
+	return std::nullopt;
+}
+
+} // namespace screeps
@@ -0,0 +1,224 @@
+export module screeps:stats;
+import :heap;
+import auto_js;
+import std;
+import util;
+
+namespace screeps {
+
+// Counters of one search. Times are in nanoseconds, and `callback_time` is part of `expand_time`
+// when rooms are opened during expansion.
+export struct search_stats {
+		// Heap pops, including `stale` pops of nodes which were improved after being pushed
+		std::uint64_t popped{};
+		std::uint64_t stale{};
+		// `push_node` calls which opened a node or lowered its cost
+		std::uint64_t pushed{};
+		// Nodes pushed past the inline capacity of the heap
+		std::uint64_t spills{};
+		std::uint64_t rooms_opened{};
+		// Rooms without terrain, or which the room callback blocked
+		std::uint64_t rooms_blocked{};
+		std::uint64_t callbacks{};
+		std::uint64_t callback_time{};
+		// Successful JPS jumps and the number of tiles they skipped
+		std::uint64_t jumps{};
+		std::uint64_t jump_length{};
+		std::uint64_t expand_time{};
+		std::uint64_t total_time{};
+
+		auto record_jump(int length) -> void {
+			++jumps;
+			jump_length += static_cast<std::uint64_t>(length);
+		}
+};
+
+// Elapsed nanoseconds since `start`, for `search_stats` times
+export auto nanoseconds_since(std::chrono::steady_clock::time_point start) -> std::uint64_t {
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+// Counters of `search_stats` summed by `record_search`
+constexpr auto counters = std::array{
+	&search_stats::popped,
+	&search_stats::stale,
+	&search_stats::pushed,
+	&search_stats::spills,
+	&search_stats::rooms_opened,
+	&search_stats::rooms_blocked,
+	&search_stats::callbacks,
+	&search_stats::callback_time,
+	&search_stats::jumps,
+	&search_stats::jump_length,
+	&search_stats::expand_time,
+	&search_stats::total_time,
+};
+
+// Histograms have one bucket per power of two
+constexpr auto k_histogram_buckets = std::size_t{32};
+using histogram_type = std::array<std::atomic<std::uint64_t>, k_histogram_buckets>;
+
+// Totals of every search run on one thread. Only the owning thread writes, so counters are updated
+// with plain relaxed stores instead of read-modify-write operations, and `process_stats` may read
+// them at any time without a lock.
+struct thread_stats {
+		std::atomic<std::uint64_t> searches;
+		std::array<std::atomic<std::uint64_t>, counters.size()> totals;
+		// Nodes expanded and microseconds spent per search
+		histogram_type ops;
+		histogram_type time;
+};
+
+// Blocks outlive their threads so that totals are never lost. The lock is only taken when a thread
+// runs its first search and by `process_stats`.
+std::mutex thread_stats_lock;
+std::deque<thread_stats> thread_stats_blocks;
+
+auto this_thread_stats() -> thread_stats& {
+	thread_local thread_stats* block = [] {
+		std::lock_guard lock{thread_stats_lock};
+		return &thread_stats_blocks.emplace_back();
+	}();
+	return *block;
+}
+
+auto add(std::atomic<std::uint64_t>& counter, std::uint64_t value) -> void {
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+auto bucket_of(std::uint64_t value) -> std::size_t {
+	return std::min<std::size_t>(std::bit_width(value), k_histogram_buckets - 1);
+}
+
+// Counters of the last search on this thread, for `searchStats`
+thread_local search_stats last_search;
+
+// Adds one finished search to this thread's totals
+export auto record_search(const search_stats& stats) -> void {
+	auto& block = this_thread_stats();
+	add(block.searches, 1);
+	for (const auto& [ total, counter ] : std::views::zip(block.totals, counters)) {
+		add(total, stats.*counter);
+	}
+	add(block.ops[ bucket_of(stats.popped - stats.stale) ], 1);
+	add(block.time[ bucket_of(stats.total_time / 1'000) ], 1);
+	last_search = stats;
+}
+
+// Resets `stats` and records it once the search is done. Heap spills are counted on the whole
+// thread, so they include those of searches run from the room callback.
+export class stats_scope {
+	public:
+		explicit stats_scope(search_stats& stats) :
+				stats_{stats},
+				spills_{heap_spills()} {
+			stats_ = search_stats{};
+		}
+		stats_scope(const stats_scope&) = delete;
+		stats_scope(stats_scope&&) = delete;
+		~stats_scope() {
+			stats_.spills = heap_spills() - spills_;
+			stats_.total_time = nanoseconds_since(started_);
+			record_search(stats_);
+		}
+		auto operator=(const stats_scope&) -> stats_scope& = delete;
+		auto operator=(stats_scope&&) -> stats_scope& = delete;
+
+		[[nodiscard]] auto started() const -> std::chrono::steady_clock::time_point { return started_; }
+
+	private:
+		search_stats& stats_;
+		std::chrono::steady_clock::time_point started_ = std::chrono::steady_clock::now();
+		std::uint64_t spills_;
+};
+
+// Counters passed to JS. Times are in microseconds. Histograms count searches by the bit width of
+// their expanded nodes or microseconds, so bucket `n` holds values in `[2^(n-1), 2^n)`.
+export struct stats_report {
+		double callback_time{};
+		double callbacks{};
+		double expand_time{};
+		double jump_length{};
+		double jumps{};
+		std::vector<double> ops_histogram;
+		double popped{};
+		double pushed{};
+		double rooms_blocked{};
+		double rooms_opened{};
+		double searches{};
+		double spills{};
+		double stale{};
+		std::vector<double> time_histogram;
+		double total_time{};
+
+		constexpr static auto struct_template = js::struct_template{
+			js::struct_member{util::cw<"callbackTime">, &stats_report::callback_time},
+			js::struct_member{util::cw<"callbacks">, &stats_report::callbacks},
+			js::struct_member{util::cw<"expandTime">, &stats_report::expand_time},
+			js::struct_member{util::cw<"jumpLength">, &stats_report::jump_length},
+			js::struct_member{util::cw<"jumps">, &stats_report::jumps},
+			js::struct_member{util::cw<"opsHistogram">, &stats_report::ops_histogram},
+			js::struct_member{util::cw<"popped">, &stats_report::popped},
+			js::struct_member{util::cw<"pushed">, &stats_report::pushed},
+			js::struct_member{util::cw<"roomsBlocked">, &stats_report::rooms_blocked},
+			js::struct_member{util::cw<"roomsOpened">, &stats_report::rooms_opened},
+			js::struct_member{util::cw<"searches">, &stats_report::searches},
+			js::struct_member{util::cw<"spills">, &stats_report::spills},
+			js::struct_member{util::cw<"stale">, &stats_report::stale},
+			js::struct_member{util::cw<"timeHistogram">, &stats_report::time_histogram},
+			js::struct_member{util::cw<"totalTime">, &stats_report::total_time},
+		};
+};
+
+auto make_report(const search_stats& stats, std::uint64_t searches) -> stats_report {
+	auto count = [](std::uint64_t value) -> double { return static_cast<double>(value); };
+	auto micros = [](std::uint64_t value) -> double { return static_cast<double>(value) / 1'000; };
+	return stats_report{
+		.callback_time = micros(stats.callback_time),
+		.callbacks = count(stats.callbacks),
+		.expand_time = micros(stats.expand_time),
+		.jump_length = count(stats.jump_length),
+		.jumps = count(stats.jumps),
+		.popped = count(stats.popped),
+		.pushed = count(stats.pushed),
+		.rooms_blocked = count(stats.rooms_blocked),
+		.rooms_opened = count(stats.rooms_opened),
+		.searches = count(searches),
+		.spills = count(stats.spills),
+		.stale = count(stats.stale),
+		.total_time = micros(stats.total_time),
+	};
+}
+
+// Counters of the last search which finished on this thread. Histograms are left empty.
+export auto last_search_stats() -> stats_report {
+	return make_report(last_search, 1);
+}
+
+// Totals and histograms of every search in the process
+export auto process_stats() -> stats_report {
+	auto totals = search_stats{};
+	auto searches = std::uint64_t{};
+	auto ops = std::array<std::uint64_t, k_histogram_buckets>{};
+	auto time = std::array<std::uint64_t, k_histogram_buckets>{};
+	{
+		std::lock_guard lock{thread_stats_lock};
+		for (const auto& block : thread_stats_blocks) {
+			searches += block.searches.load(std::memory_order_relaxed);
+			for (const auto& [ total, counter ] : std::views::zip(block.totals, counters)) {
+				totals.*counter += total.load(std::memory_order_relaxed);
+			}
+			for (std::size_t bucket = 0; bucket < k_histogram_buckets; ++bucket) {
+				ops[ bucket ] += block.ops[ bucket ].load(std::memory_order_relaxed);
+				time[ bucket ] += block.time[ bucket ].load(std::memory_order_relaxed);
+			}
+		}
+	}
+	auto report = make_report(totals, searches);
+	report.ops_histogram = ops | std::views::transform([](auto value) { return static_cast<double>(value); }) | std::ranges::to<std::vector>();
+	report.time_histogram = time | std::views::transform([](auto value) { return static_cast<double>(value); }) | std::ranges::to<std::vector>();
+	return report;
+}
+
+} // namespace screeps
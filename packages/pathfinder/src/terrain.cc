@@ -0,0 +1,265 @@
+export module screeps:terrain;
+import :components;
+import :hierarchy;
+import :jump_table;
+import :landmarks;
+import :room;
+import :utility;
+import auto_js;
+import std;
+import util;
+
+namespace screeps {
+
+constexpr auto map_position_size = 1 << sizeof(room_location_t) * 8;
+
+// Params for `load_terrain`
+struct room_entry {
+		room_location_t room;
+		terrain_span_type terrain;
+
+		constexpr static auto struct_template = js::struct_template{
+			js::struct_member{util::cw<"room">, &room_entry::room},
+			js::struct_member{util::cw<"terrain">, &room_entry::terrain},
+		};
+};
+export using world_type = std::vector<room_entry>;
+using terrain_map_type = std::array<terrain_type, map_position_size>;
+
+// Room exit sides, bit layout matches `exits` of `RoomIntrinsics` in JS
+constexpr auto k_exit_top = std::uint8_t{1};
+constexpr auto k_exit_right = std::uint8_t{2};
+constexpr auto k_exit_bottom = std::uint8_t{4};
+constexpr auto k_exit_left = std::uint8_t{8};
+using room_exits_type = std::array<std::uint8_t, map_position_size>;
+
+// Index into the tables below
+constexpr auto room_id_of(room_location_t room) -> std::uint16_t {
+	return std::bit_cast<std::uint16_t>(room);
+}
+
+// Per-process terrain data
+terrain_map_type terrain_map;
+room_exits_type room_exits;
+
+// Table derived from the terrain of each room. Tables are built the first time a search needs them,
+// so that loading a large world, or mapping a shared terrain file, doesn't build them for every
+// room upfront.
+template <class Type>
+class derived_room_tables {
+	public:
+		using make_type = auto (*)(terrain_type terrain) -> std::unique_ptr<const Type>;
+		explicit derived_room_tables(make_type make) :
+				make_{make} {}
+
+		// Returns the table of `room`, or `nullptr` if its terrain isn't loaded
+		auto operator()(room_location_t room) -> const Type* {
+			auto room_id = room_id_of(room);
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			if (const auto* table = published_[ room_id ].load(std::memory_order_acquire); table != nullptr) {
+				return table;
+			}
+			std::lock_guard lock{lock_};
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			const auto* terrain = terrain_map[ room_id ];
+			if (terrain == nullptr) {
+				return nullptr;
+			}
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			auto& owned = owned_[ room_id ];
+			if (owned == nullptr) {
+				owned = make_(terrain);
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+				published_[ room_id ].store(owned.get(), std::memory_order_release);
+			}
+			return owned.get();
+		}
+
+		// Stops handing out the table of a room whose terrain was replaced. Searches on other threads
+		// may still hold the old table, so it's kept for the life of the process like the terrain
+		// itself.
+		auto reset(room_location_t room) -> void {
+			auto room_id = room_id_of(room);
+			std::lock_guard lock{lock_};
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			published_[ room_id ].store(nullptr, std::memory_order_release);
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+			if (auto& owned = owned_[ room_id ]; owned != nullptr) {
+				retired_.push_back(std::move(owned));
+			}
+		}
+
+	private:
+		make_type make_;
+		std::mutex lock_;
+		std::array<std::atomic<const Type*>, map_position_size> published_{};
+		std::array<std::unique_ptr<const Type>, map_position_size> owned_;
+		std::vector<std::unique_ptr<const Type>> retired_;
+};
+
+derived_room_tables<room_graph_t> room_graphs{[](terrain_type terrain) -> std::unique_ptr<const room_graph_t> {
+	return std::make_unique<const room_graph_t>(make_room_graph(terrain));
+}};
+derived_room_tables<jump_table_t> jump_tables{[](terrain_type terrain) -> std::unique_ptr<const jump_table_t> {
+	return std::make_unique<const jump_table_t>(terrain);
+}};
+
+// Returns true if the packed terrain is a wall at the given room coordinates
+constexpr auto is_terrain_wall(terrain_type terrain, unsigned xx, unsigned yy) -> bool {
+	auto index = (yy * 50) + xx;
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	return ((unsigned{terrain[ index / 4 ]} >> (index % 4 * 2)) & 0x01) != 0;
+}
+
+// A room has an exit on each side with at least one walkable border tile
+constexpr auto exits_from_terrain(terrain_type terrain) -> std::uint8_t {
+	auto exits = std::uint8_t{0};
+	for (unsigned ii = 0; ii < 50; ++ii) {
+		exits |= is_terrain_wall(terrain, ii, 0) ? 0 : k_exit_top;
+		exits |= is_terrain_wall(terrain, 49, ii) ? 0 : k_exit_right;
+		exits |= is_terrain_wall(terrain, ii, 49) ? 0 : k_exit_bottom;
+		exits |= is_terrain_wall(terrain, 0, ii) ? 0 : k_exit_left;
+	}
+	return exits;
+}
+
+// Terrain file layout, in native byte order since the file is meant to be shared by processes on one
+// host: the header, then the id of each room, padded to 4 bytes, then the packed terrain of each
+// room in the same order
+struct terrain_file_header {
+		std::array<char, 4> magic;
+		std::uint32_t version;
+		std::uint32_t rooms;
+};
+constexpr auto k_terrain_file_magic = std::array{'x', 'x', 't', 'r'};
+constexpr auto k_terrain_file_version = std::uint32_t{1};
+constexpr auto k_room_terrain_size = std::size_t{625};
+
+constexpr auto terrain_offset_of(std::size_t rooms) -> std::size_t {
+	auto ids = sizeof(terrain_file_header) + (rooms * sizeof(std::uint16_t));
+	return (ids + 3) & ~std::size_t{3};
+}
+
+// Sets one room's terrain. `terrain` must outlive the process. Derived tables are kept if the
+// terrain is unchanged, which is the case for each processor thread loading the same world. Returns
+// true if the terrain changed.
+auto load_room(room_location_t room, terrain_type terrain) -> bool {
+	auto room_id = room_id_of(room);
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+	const auto* previous = terrain_map[ room_id ];
+	auto unchanged = previous != nullptr && std::memcmp(previous, terrain, k_room_terrain_size) == 0;
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+	terrain_map[ room_id ] = terrain;
+	if (!unchanged) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+		room_exits[ room_id ] = exits_from_terrain(terrain);
+		room_graphs.reset(room);
+		jump_tables.reset(room);
+	}
+	return !unchanged;
+}
+
+// Landmark distances and terrain components span every loaded room, not just the last batch. Both
+// are built once a search needs them.
+auto load_world_tables() -> void {
+	auto rooms = landmark_rooms_type{};
+	for (const auto& [ room_id, terrain ] : std::views::enumerate(terrain_map)) {
+		if (terrain != nullptr) {
+			rooms.emplace_back(std::bit_cast<room_location_t>(static_cast<std::uint16_t>(room_id)), terrain);
+		}
+	}
+	reset_components(rooms);
+	reset_landmarks(std::move(rooms));
+}
+
+// Loads static terrain data into module upfront
+std::mutex terrain_lock;
+export auto load_terrain(const world_type& world) -> void {
+	std::lock_guard<std::mutex> lock{terrain_lock};
+	// Parse out terrain by rooms
+	auto changed = false;
+	for (const auto& entry : world) {
+		changed |= load_room(entry.room, entry.terrain.data());
+	}
+	if (changed) {
+		load_world_tables();
+	}
+}
+
+// Mapped terrain files are never unmapped, since `terrain_map` points into them
+std::deque<mapped_file> terrain_files;
+
+// Points `terrain_map` at a terrain file written by `save_terrain_file`. Returns false if the file
+// is missing or was written by another version.
+export auto load_terrain_file(const std::string& path) -> bool {
+	std::lock_guard<std::mutex> lock{terrain_lock};
+	const auto& file = terrain_files.emplace_back(path);
+	auto bytes = file.bytes();
+	auto header = terrain_file_header{};
+	if (bytes.size() < sizeof(header)) {
+		terrain_files.pop_back();
+		return false;
+	}
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	auto terrain_offset = terrain_offset_of(header.rooms);
+	if (
+		header.magic != k_terrain_file_magic ||
+		header.version != k_terrain_file_version ||
+		bytes.size() != terrain_offset + (header.rooms * k_room_terrain_size)
+	) {
+		terrain_files.pop_back();
+		return false;
+	}
+	auto changed = false;
+	for (std::size_t ii = 0; ii < header.rooms; ++ii) {
+		auto room_id = std::uint16_t{};
+		std::memcpy(&room_id, bytes.subspan(sizeof(header) + (ii * sizeof(room_id))).data(), sizeof(room_id));
+		changed |= load_room(std::bit_cast<room_location_t>(room_id), bytes.subspan(terrain_offset + (ii * k_room_terrain_size)).data());
+	}
+	if (changed) {
+		load_world_tables();
+	}
+	return true;
+}
+
+// Writes `world` as a terrain file. The contents go to a temporary file which is then renamed over
+// `path`, so processes which map it never see a partial file. Returns false on failure.
+export auto save_terrain_file(const std::string& path, const world_type& world) -> bool {
+	if (std::ranges::any_of(world, [](const room_entry& entry) -> bool { return entry.terrain.size() != k_room_terrain_size; })) {
+		return false;
+	}
+	auto header = terrain_file_header{
+		.magic = k_terrain_file_magic,
+		.version = k_terrain_file_version,
+		.rooms = static_cast<std::uint32_t>(world.size()),
+	};
+	auto bytes = std::vector<char>(terrain_offset_of(world.size()) + (world.size() * k_room_terrain_size));
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	for (std::size_t ii = 0; ii < world.size(); ++ii) {
+		auto room_id = room_id_of(world[ ii ].room);
+		std::memcpy(&bytes[ sizeof(header) + (ii * sizeof(room_id)) ], &room_id, sizeof(room_id));
+		std::ranges::copy(world[ ii ].terrain, &bytes[ terrain_offset_of(world.size()) + (ii * k_room_terrain_size) ]);
+	}
+
+	auto temporary = std::filesystem::path{path};
+	temporary += std::format(".{:x}.tmp", std::random_device{}());
+	{
+		auto stream = std::ofstream{temporary, std::ios::binary | std::ios::trunc};
+		stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+		if (!stream.good()) {
+			stream.close();
+			auto error = std::error_code{};
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+	auto error = std::error_code{};
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	return true;
+}
+
+} // namespace screeps
@@ -1,3 +1,12 @@
+module;
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 export module screeps:utility;
 import std;
 import util;
@@ -72,6 +81,185 @@ class nominal {
 		Type value;
 };
 
+// Pointer to one field of consecutive records. Indexing steps `Stride` bytes at a time, or a stride
+// given at runtime when `Stride` is 0.
+template <class Type, std::size_t Stride = sizeof(Type)>
+class strided_pointer {
+	public:
+		constexpr strided_pointer() = default;
+		explicit constexpr strided_pointer(Type* data)
+			requires(Stride != 0) : data_{data} {}
+		constexpr strided_pointer(Type* data, std::size_t stride)
+			requires(Stride == 0) : data_{data}, stride_{stride} {}
+
+		// Erases the stride of, or adds `const` to, another pointer
+		template <class From, std::size_t FromStride>
+			requires(Stride == 0 && std::is_convertible_v<From*, Type*>)
+		// NOLINTNEXTLINE(google-explicit-constructor)
+		constexpr strided_pointer(strided_pointer<From, FromStride> pointer) :
+				data_{pointer.data()},
+				stride_{pointer.stride()} {}
+
+		[[nodiscard]] constexpr auto data() const -> Type* { return data_; }
+		[[nodiscard]] constexpr auto stride() const -> std::size_t { return Stride == 0 ? stride_ : Stride; }
+
+		constexpr auto operator[](std::size_t index) const -> Type& {
+			using byte_type = std::conditional_t<std::is_const_v<Type>, const std::byte, std::byte>;
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			return *reinterpret_cast<Type*>(reinterpret_cast<byte_type*>(data_) + (index * stride()));
+		}
+
+	private:
+		Type* data_{};
+		std::size_t stride_{Stride};
+};
+
+// Zero-filled array in its own reserved address range. The operating system only backs pages with
+// memory once they are touched, so a search which opens a couple of rooms only pays for those rooms.
+// `Type` must be valid when all of its bytes are zero.
+template <class Type>
+class reserved_array {
+	public:
+		static_assert(std::is_trivially_copyable_v<Type> && std::is_trivially_destructible_v<Type>);
+
+		explicit reserved_array(std::size_t size) : size_{size} {
+			auto bytes = std::max(size, std::size_t{1}) * sizeof(Type);
+#ifdef _WIN32
+			// Committed pages are still demand-zero, so this does not make them resident
+			auto* data = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			if (data == nullptr) {
+				throw std::bad_alloc{};
+			}
+#else
+			auto* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			if (data == MAP_FAILED) {
+				throw std::bad_alloc{};
+			}
+#if defined(PATHFINDER_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+			madvise(data, bytes, MADV_HUGEPAGE);
+#endif
+#endif
+			data_ = static_cast<Type*>(data);
+		}
+
+		reserved_array(const reserved_array&) = delete;
+		reserved_array(reserved_array&&) = delete;
+		~reserved_array() {
+#ifdef _WIN32
+			VirtualFree(data_, 0, MEM_RELEASE);
+#else
+			munmap(data_, std::max(size_, std::size_t{1}) * sizeof(Type));
+#endif
+		}
+		auto operator=(const reserved_array&) -> reserved_array& = delete;
+		auto operator=(reserved_array&&) -> reserved_array& = delete;
+
+		[[nodiscard]] auto data() const -> Type* { return data_; }
+		[[nodiscard]] auto size() const -> std::size_t { return size_; }
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto operator[](std::size_t index) const -> Type& { return data_[ index ]; }
+
+		// Gives back the whole pages past element `index`. They read as zero again once touched.
+		auto release_from(std::size_t index) -> void {
+			auto page = page_size();
+			auto begin = ((index * sizeof(Type)) + page - 1) / page * page;
+			auto end = size_ * sizeof(Type) / page * page;
+			if (begin >= end) {
+				return;
+			}
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			auto* address = reinterpret_cast<std::byte*>(data_) + begin;
+#ifdef _WIN32
+			VirtualFree(address, end - begin, MEM_DECOMMIT);
+			VirtualAlloc(address, end - begin, MEM_COMMIT, PAGE_READWRITE);
+#else
+			madvise(address, end - begin, MADV_DONTNEED);
+#endif
+		}
+
+	private:
+		static auto page_size() -> std::size_t {
+#ifdef _WIN32
+			static const auto size = [] {
+				auto info = SYSTEM_INFO{};
+				GetSystemInfo(&info);
+				return static_cast<std::size_t>(info.dwPageSize);
+			}();
+#else
+			static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+			return size;
+		}
+
+		Type* data_{};
+		std::size_t size_;
+};
+
+// Read-only mapping of a whole file. Pages are shared with every other process which maps the same
+// file, and are only read from disk when touched. `bytes()` is empty if the file could not be
+// mapped.
+class mapped_file {
+	public:
+		explicit mapped_file(const std::filesystem::path& path) {
+#ifdef _WIN32
+			auto* file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE) {
+				return;
+			}
+			auto size = LARGE_INTEGER{};
+			if (GetFileSizeEx(file, &size) != 0 && size.QuadPart > 0) {
+				auto* mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping != nullptr) {
+					auto* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					if (data != nullptr) {
+						data_ = static_cast<const std::uint8_t*>(data);
+						size_ = static_cast<std::size_t>(size.QuadPart);
+					}
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(file);
+#else
+			auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd == -1) {
+				return;
+			}
+			struct stat info {};
+			if (fstat(fd, &info) == 0 && info.st_size > 0) {
+				auto size = static_cast<std::size_t>(info.st_size);
+				auto* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+				if (data != MAP_FAILED) {
+					data_ = static_cast<const std::uint8_t*>(data);
+					size_ = size;
+				}
+			}
+			close(fd);
+#endif
+		}
+
+		mapped_file(const mapped_file&) = delete;
+		mapped_file(mapped_file&&) = delete;
+		~mapped_file() {
+			if (data_ == nullptr) {
+				return;
+			}
+#ifdef _WIN32
+			UnmapViewOfFile(data_);
+#else
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+			munmap(const_cast<std::uint8_t*>(data_), size_);
+#endif
+		}
+		auto operator=(const mapped_file&) -> mapped_file& = delete;
+		auto operator=(mapped_file&&) -> mapped_file& = delete;
+
+		[[nodiscard]] auto bytes() const -> std::span<const std::uint8_t> { return {data_, size_}; }
+
+	private:
+		const std::uint8_t* data_{};
+		std::size_t size_{};
+};
+
 // Minimal polyfill for std::inplace_vector
 template <class Type, std::size_t Size>
 class inplace_vector : private std::allocator<Type> {
@@ -122,6 +310,47 @@ class inplace_vector : private std::allocator<Type> {
 		std::size_t size_ = 0;
 };
 
+// `inplace_vector` which continues into a heap allocated arena once its inline capacity is used up.
+// Elements past `Size` are not contiguous with the inline ones. The arena keeps its capacity after
+// `clear`, so it is only allocated by the first search which needs it.
+template <class Type, std::size_t Size>
+class spill_vector {
+	public:
+		[[nodiscard]] constexpr auto empty() const -> bool { return inline_.empty(); }
+		[[nodiscard]] constexpr auto size() const -> std::size_t { return inline_.size() + spill_.size(); }
+		constexpr auto back(this auto& self) -> auto& { return self[ self.size() - 1 ]; }
+		constexpr auto operator[](this auto& self, std::size_t index) -> auto& {
+			return index < Size ? self.inline_[ index ] : self.spill_[ index - Size ];
+		}
+
+		constexpr auto clear() -> void {
+			spill_.clear();
+			inline_.clear();
+		}
+
+		constexpr auto pop_back() -> void {
+			if (spill_.empty()) {
+				inline_.pop_back();
+			} else {
+				spill_.pop_back();
+			}
+		}
+
+		// Returns true if the element was placed in the arena
+		constexpr auto emplace_back(auto&&... args) -> bool {
+			if (inline_.size() < Size) {
+				inline_.emplace_back(std::forward<decltype(args)>(args)...);
+				return false;
+			}
+			spill_.emplace_back(std::forward<decltype(args)>(args)...);
+			return true;
+		}
+
+	private:
+		inplace_vector<Type, Size> inline_;
+		std::vector<Type> spill_;
+};
+
 // Recursive invocations will invoke the callback with subsequently later references of `Type...`
 // until there are no more. Then it will invoke it with no parameter.
 export template <class... Type>
@@ -147,6 +376,44 @@ class resource_recursion_stack {
 		std::tuple<Type...> resources_;
 };
 
+// Native objects which outlive the call that made them are kept here and referred to by an integer
+// handle. Each object belongs to an owner, usually the isolate which made it, which stops sandboxes
+// from reaching each other's objects.
+export template <class Type>
+class handle_registry {
+	public:
+		auto insert(const void* owner, std::shared_ptr<Type> value) -> int {
+			std::lock_guard lock{mutex_};
+			auto handle = ++last_handle_;
+			entries_.emplace(handle, std::pair{owner, std::move(value)});
+			return handle;
+		}
+
+		// Returns `nullptr` if the handle was freed or belongs to another owner. Ownership is shared so
+		// that freeing an object from within a callback it invoked is safe.
+		auto find(const void* owner, int handle) -> std::shared_ptr<Type> {
+			std::lock_guard lock{mutex_};
+			auto entry = entries_.find(handle);
+			if (entry == entries_.end() || entry->second.first != owner) {
+				return nullptr;
+			}
+			return entry->second.second;
+		}
+
+		auto erase(const void* owner, int handle) -> void {
+			std::lock_guard lock{mutex_};
+			auto entry = entries_.find(handle);
+			if (entry != entries_.end() && entry->second.first == owner) {
+				entries_.erase(entry);
+			}
+		}
+
+	private:
+		std::mutex mutex_;
+		std::unordered_map<int, std::pair<const void*, std::shared_ptr<Type>>> entries_;
+		int last_handle_{};
+};
+
 }; // namespace screeps
 
 namespace std {
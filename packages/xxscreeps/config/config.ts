@@ -161,6 +161,13 @@ export interface ProcessorConfig {
 	 * @default false
 	 */
 	log?: boolean;
+
+	/**
+	 * Number of extra threads each processor starts for batches of independent path finder searches.
+	 * Processors already run one task per core, so this only helps when `concurrency` is lower.
+	 * @default 0
+	 */
+	pathFinderThreads?: number;
 }
 
 export interface RunnerConfig {
@@ -291,6 +298,7 @@ export const defaults = {
 	processor: {
 		concurrency: os.availableParallelism() + 1,
 		intentAbandonTimeout: 5000,
+		pathFinderThreads: 0,
 	},
 	runner: {
 		concurrency: os.availableParallelism() + 1,
@@ -1,9 +1,11 @@
 import type { World } from 'xxscreeps/game/map.js';
+import type { CostMatrix } from 'xxscreeps/game/pathfinder/cost-matrix.js';
 import type { Goal, SearchOptions } from 'xxscreeps/game/pathfinder/index.js';
 import type { PositionLike } from 'xxscreeps/game/position.js';
 import type { OneOrMany } from 'xxscreeps/utility/types.js';
 import * as pf from '@xxscreeps/pathfinder';
 import { Fn } from 'xxscreeps/functional/fn.js';
+import { Game } from 'xxscreeps/game/index.js';
 import { RoomPosition } from 'xxscreeps/game/position.js';
 import { makeRoomNameFromId, parseRoomNameToId } from 'xxscreeps/game/room/name.js';
 import { getBuffer } from 'xxscreeps/game/terrain.js';
@@ -26,18 +28,45 @@ const makePositionOut = (xx: number, yy: number) =>
 
 export const path = pf.path;
 
-export function loadTerrain(world: World) {
-	const worldTerrain = Fn.map(world.entries(), ([ name, terrain ]) => {
+// Sets the number of native threads used by `searchParallel`, besides the calling thread. Only
+// available in nodejs.
+export const configureParallelSearch = pf.configureParallelSearch;
+
+// Counters of the last search on this thread, and totals of every search in the process. Times are
+// in microseconds, and `stats` is only available in nodejs.
+export const searchStats = pf.searchStats;
+export const stats = pf.stats;
+
+function makeWorldTerrain(world: World) {
+	return Fn.map(world.entries(), ([ name, terrain ]) => {
 		const roomId = parseRoomNameToId(name);
 		const buffer = getBuffer(terrain);
 		return [ roomId, buffer ] as const;
 	});
-	pf.loadTerrain(worldTerrain);
 }
 
-export function search(origin: RoomPosition, goal: OneOrMany<Goal>, options: SearchOptions = {}) {
+export function loadTerrain(world: World) {
+	pf.loadTerrain(makeWorldTerrain(world));
+}
+
+/**
+ * Loads terrain from a file which is mapped read-only and shared by every process on this host. The
+ * file is written from `world` if it doesn't exist yet, and `loadTerrain` is used if that fails.
+ * `path` must be unique to the terrain, for example by naming it after a hash of the terrain blob,
+ * and in a directory which only this server can write to, since an existing file is trusted as is.
+ */
+export function loadTerrainFile(world: World, path: string) {
+	if (
+		!pf.loadTerrainFile(path) &&
+		!(pf.saveTerrainFile(path, makeWorldTerrain(world)) && pf.loadTerrainFile(path))
+	) {
+		loadTerrain(world);
+	}
+}
+
+function makeGoals(goal: OneOrMany<Goal>) {
 	// Convert one-or-many goal into standard format for native extension
-	const goals = (Array.isArray(goal) ? goal : [ goal ]).map(goal => {
+	return (Array.isArray(goal) ? goal : [ goal ]).map(goal => {
 		// eslint-disable-next-line @typescript-eslint/no-unnecessary-condition
 		if (goal.roomName === undefined && goal.x === undefined && goal.y === undefined) {
 			// This case detects `Goal` and `RoomObject`. The path finder was never meant to accept game
@@ -53,10 +82,10 @@ export function search(origin: RoomPosition, goal: OneOrMany<Goal>, options: Sea
 			};
 		}
 	});
+}
 
-	// Setup room callback
-	const { roomCallback } = options;
-	const callback = roomCallback === undefined ? undefined : (roomId: number) => {
+function makeRoomCallback(roomCallback: SearchOptions['roomCallback']) {
+	return roomCallback === undefined ? undefined : (roomId: number) => {
 		const ret = roomCallback(makeRoomNameFromId(roomId));
 		if (ret === false) {
 			return ret;
@@ -64,12 +93,155 @@ export function search(origin: RoomPosition, goal: OneOrMany<Goal>, options: Sea
 			return ret._bits;
 		}
 	};
+}
+
+/**
+ * Cost matrices known before a search starts. `roomCallback` is only invoked for rooms which are
+ * not listed.
+ */
+export type PreloadedMatrices = Iterable<readonly [ string, CostMatrix | false ]>;
 
+function makeMatrices(matrices: PreloadedMatrices | undefined) {
+	return matrices && Fn.map(matrices, ([ roomName, matrix ]) => [ parseRoomNameToId(roomName), matrix && matrix._bits ] as const);
+}
+
+/**
+ * Options which are only offered by the driver. `cacheTime` may be given instead of `cache` when
+ * running outside of a game tick.
+ */
+interface DriverOptions {
+	cacheTime?: number;
+	checkInterval?: number;
+	matrices?: PreloadedMatrices;
+	matrixStore?: MatrixStore;
+	matrixVariant?: string;
+}
+
+function makeOptions(options: SearchOptions & DriverOptions) {
+	const matrices = makeMatrices(options.matrices);
+	const matrixStore = options.matrixStore?.['#store'];
+	return options.cache ? { cacheTime: Game.time, ...options, matrices, matrixStore } : { ...options, matrices, matrixStore };
+}
+
+export function search(origin: RoomPosition, goal: OneOrMany<Goal>, options: SearchOptions & DriverOptions = {}) {
 	// Invoke native code
 	return pf.search(
-		makePositionIn(origin), goals,
-		callback,
+		makePositionIn(origin), makeGoals(goal),
+		makeRoomCallback(options.roomCallback),
+		makePositionOut,
+		makeOptions(options),
+	);
+}
+
+/**
+ * Same as `search`, but the path is returned as packed world positions, with the direction of each
+ * step if `options.directions` is set.
+ */
+export function searchPacked(origin: RoomPosition, goal: OneOrMany<Goal>, options: SearchOptions & DriverOptions & { directions?: boolean } = {}) {
+	return pf.searchPacked(
+		makePositionIn(origin), makeGoals(goal),
+		makeRoomCallback(options.roomCallback),
+		makeOptions(options),
+	);
+}
+
+export function searchMany(
+	queries: readonly { origin: RoomPosition; goal: OneOrMany<Goal>; options?: SearchOptions }[],
+	roomCallback?: SearchOptions['roomCallback'],
+) {
+	return pf.searchMany(
+		queries.map(({ origin, goal, options = {} }) => ({
+			origin: makePositionIn(origin),
+			goals: makeGoals(goal),
+			options,
+		})),
+		makeRoomCallback(roomCallback),
+		makePositionOut,
+	);
+}
+
+/**
+ * Runs independent searches on native worker threads. Each room's cost matrix must be given ahead of
+ * time since room callbacks can't run off the main thread.
+ */
+export function searchParallel(
+	queries: readonly { origin: RoomPosition; goal: OneOrMany<Goal>; options?: SearchOptions }[],
+	matrices: Iterable<readonly [ string, CostMatrix | false ]> = [],
+) {
+	return pf.searchParallel(
+		queries.map(({ origin, goal, options = {} }) => ({
+			origin: makePositionIn(origin),
+			goals: makeGoals(goal),
+			options,
+		})),
+		Fn.map(matrices, ([ roomName, matrix ]) => [ parseRoomNameToId(roomName), matrix && matrix._bits ] as const),
 		makePositionOut,
-		options,
 	);
 }
+
+/**
+ * Starts a search which can be spread over several calls. Each `resume` expands up to `maxOps` more
+ * nodes and returns the best path so far, with `done` set once the search is finished.
+ */
+export function startSearch(origin: RoomPosition, goal: OneOrMany<Goal>, options: SearchOptions = {}) {
+	const search = pf.startSearch({
+		origin: makePositionIn(origin),
+		goals: makeGoals(goal),
+		options,
+	});
+	const roomCallback = makeRoomCallback(options.roomCallback);
+	return {
+		resume: (maxOps: number) => search.resume(roomCallback, makePositionOut, maxOps),
+		free: () => search.free(),
+	};
+}
+
+/**
+ * Creates an incremental planner toward `goal`. Each `update` moves the origin and applies changed
+ * tile costs, then repairs the previous path instead of searching again. `options.roomCallback` is
+ * invoked once per room, so later changes to that room must be passed to `update`.
+ */
+export function createPlanner(origin: RoomPosition, goal: OneOrMany<Goal>, options: SearchOptions = {}) {
+	const planner = pf.createPlanner(makePositionIn(origin), makeGoals(goal), options);
+	const roomCallback = makeRoomCallback(options.roomCallback);
+	return {
+		update: (origin: RoomPosition, changes: Iterable<readonly [ RoomPosition, number ]> = [], maxOps?: number) =>
+			planner.update(
+				makePositionIn(origin),
+				Array.from(changes, ([ pos, cost ]) => ({ pos: makePositionIn(pos), cost })),
+				roomCallback,
+				makePositionOut,
+				maxOps,
+			),
+		free: () => planner.free(),
+	};
+}
+
+/**
+ * Creates a store of cost matrices which stay loaded in native memory between searches and ticks.
+ * Searches read the store given by `options.matrixStore` before invoking `roomCallback`.
+ */
+export function createMatrixStore() {
+	const store = pf.createMatrixStore();
+	return {
+		'#store': store,
+		set: (variant: string, matrices: PreloadedMatrices) => store.set(variant, makeMatrices(matrices)!),
+		patch: (variant: string, changes: Iterable<readonly [ RoomPosition, number ]>) =>
+			store.patch(variant, Array.from(changes, ([ pos, cost ]) => ({ pos: makePositionIn(pos), cost }))),
+		clear: (variant?: string) => store.clear(variant),
+		version: (variant: string, roomName: string) => store.version(variant, parseRoomNameToId(roomName)),
+		free: () => store.free(),
+	};
+}
+
+export type MatrixStore = ReturnType<typeof createMatrixStore>;
+
+export function distanceField(goal: OneOrMany<Goal>, options: SearchOptions = {}) {
+	const fields = pf.distanceField(makeGoals(goal), makeRoomCallback(options.roomCallback), options);
+	return new Map(Fn.map(fields, ([ roomId, field ]) => [ makeRoomNameFromId(roomId), field ] as const));
+}
+
+export function findRoute(fromRoom: string, toRoom: string) {
+	const route = pf.findRoute(parseRoomNameToId(fromRoom), parseRoomNameToId(toRoom), undefined);
+	return route?.map(makeRoomNameFromId);
+}
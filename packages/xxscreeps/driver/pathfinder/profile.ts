@@ -14,12 +14,17 @@ import { TERRAIN_MASK_WALL } from 'xxscreeps/game/terrain.js';
 
 const iterations = Number(process.argv.at(-1)) || 1;
 const log = process.argv.includes('--log');
+const verify = !process.argv.includes('--no-verify');
 const expectedResult = 'cb11d874';
 
 /**
  * This script is a standalone test for the path finder. It runs a whole bunch of path finding
  * operations on real terrain data from a screeps server. It also verifies that the results are the
  * same as previous runs (kind of). This is also used for profile-guided optimization builds.
+ *
+ * It also compares the open list policies: build the native module with `-DPATHFINDER_QUEUE=radix`
+ * or `-DPATHFINDER_QUEUE=tiebreak` and compare the time and total ops printed here. Tie-breaking
+ * may pick different paths of the same cost, so pass `--no-verify` for those builds.
  */
 
 // Load terrain into module
@@ -91,6 +96,9 @@ const matrices = function() {
 		$$ => Fn.fromEntries($$));
 }();
 
+// Total expanded nodes over every search, for comparing queue policies
+let ops = 0;
+
 // Dispatch pathfinding profile
 const dispatch = (update: (result: unknown) => void) => {
 	const positions = makePositions();
@@ -133,11 +141,14 @@ if (process.argv.includes('--with-sandbox')) {
 	await using agent = await Agent.create();
 	const realm = expect(await agent.createRealm());
 	const hash = crypto.createHash('sha256');
+	// Results are parsed for their ops after the timed run
+	const results: string[] = [];
 	const hook = expect(await realm.createCapability(
 		() => ({
 			update: result => {
 				const string = String(result);
 				hash.update(string);
+				results.push(string);
 				if (log) {
 					console.log(util.inspect(JSON.parse(string), { depth: null, maxArrayLength: null }));
 				}
@@ -201,9 +212,12 @@ if (process.argv.includes('--with-sandbox')) {
 	const start = process.hrtime();
 	expectComplete(await module.evaluate(realm));
 	const time = process.hrtime(start);
-	console.log(time[0] + time[1] / 1e9);
+	for (const string of results) {
+		ops += (JSON.parse(string) as { ops?: number } | undefined)?.ops ?? 0;
+	}
+	console.log(time[0] + time[1] / 1e9, ops);
 	const checksum = hash.digest('hex').slice(0, 8);
-	if (iterations === 1 && checksum !== expectedResult) {
+	if (verify && iterations === 1 && checksum !== expectedResult) {
 		console.error('Incorrect results! ' + checksum);
 		process.exit(1);
 	}
@@ -213,6 +227,7 @@ if (process.argv.includes('--with-sandbox')) {
 	const hash = crypto.createHash('sha256');
 	const update = (result: unknown) => {
 		hash.update(JSON.stringify(result));
+		ops += (result as { ops?: number } | undefined)?.ops ?? 0;
 		if (log) {
 			console.log(util.inspect(result, { depth: null, maxArrayLength: null }));
 		}
@@ -221,8 +236,8 @@ if (process.argv.includes('--with-sandbox')) {
 	dispatch(update);
 	const time = process.hrtime(start);
 	const checksum = hash.digest('hex').slice(0, 8);
-	console.log(time[0] + time[1] / 1e9);
-	if (iterations === 1 && checksum !== expectedResult) {
+	console.log(time[0] + time[1] / 1e9, ops);
+	if (verify && iterations === 1 && checksum !== expectedResult) {
 		console.error('Incorrect results! ' + checksum);
 		process.exit(1);
 	}
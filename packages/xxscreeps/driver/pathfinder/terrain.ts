@@ -0,0 +1,19 @@
+import type { World } from 'xxscreeps/game/map.js';
+import * as crypto from 'node:crypto';
+import * as fs from 'node:fs';
+import { fileURLToPath } from 'node:url';
+import { configPath } from 'xxscreeps/config/index.js';
+import { loadTerrainFile } from 'xxscreeps/driver/pathfinder/pathfinder.js';
+
+/**
+ * Loads the path finder's terrain from a file shared by every process of this server. The file is
+ * named after a hash of the terrain blob, so worlds with different terrain never share one. An
+ * existing file is trusted as is, so it's kept in the server's `screeps/` directory next to its
+ * config rather than somewhere other users can write to.
+ */
+export function loadSharedTerrain(world: World) {
+	const hash = crypto.createHash('sha1').update(world.terrainBlob).digest('hex');
+	const directory = new URL('screeps/', configPath);
+	fs.mkdirSync(directory, { recursive: true });
+	loadTerrainFile(world, fileURLToPath(new URL(`terrain-${hash}.bin`, directory)));
+}
@@ -1,6 +1,6 @@
 import type { Room } from 'xxscreeps/game/room/room.js';
 import { config } from 'xxscreeps/config/index.js';
-import { loadTerrain } from 'xxscreeps/driver/pathfinder/pathfinder.js';
+import { loadSharedTerrain } from 'xxscreeps/driver/pathfinder/terrain.js';
 import { consumeSet } from 'xxscreeps/engine/db/async.js';
 import { Database, Shard } from 'xxscreeps/engine/db/index.js';
 import { initializeIntentConstraints, makeInitializeRoomForProcessor } from 'xxscreeps/engine/processor/index.js';
@@ -55,7 +55,7 @@ await makeBasicResponderHost<ProcessorRequest>(import.meta.url, async message =>
 		// Load world shared data between all workers in the process
 		case 'world':
 			world = new World(shard.name, message.terrainBlob);
-			loadTerrain(world);
+			loadSharedTerrain(world);
 			break;
 
 		// Initialize rooms / user relationships
@@ -1,6 +1,7 @@
 import type { ProcessorRequest } from 'xxscreeps/engine/processor/worker.js';
 import type { Effect } from 'xxscreeps/utility/types.js';
 import { config } from 'xxscreeps/config/index.js';
+import { configureParallelSearch } from 'xxscreeps/driver/pathfinder/pathfinder.js';
 import { consumeSet, consumeSortedSet, consumeSortedSetMembers } from 'xxscreeps/engine/db/async.js';
 import { Database, Shard } from 'xxscreeps/engine/db/index.js';
 import { getProcessorChannel, processRoomsSetKey } from 'xxscreeps/engine/processor/model.js';
@@ -56,6 +57,9 @@ await async function() {
 	throw new Error('Processor initialization failure');
 }();
 
+// The path finder's worker pool is shared by every processor worker thread in this process
+configureParallelSearch(config.processor.pathFinderThreads);
+
 // Create processor workers
 type RoomWorker = typeof workers extends (infer Type)[] ? Type : never;
 const userCount = Number(await db.data.sCard('users')) - 3; // minus Invader, Source Keeper, Screeps
@@ -1,7 +1,7 @@
 import type { Effect } from 'xxscreeps/utility/types.js';
 import * as Timers from 'node:timers/promises';
 import { config } from 'xxscreeps/config/index.js';
-import { loadTerrain } from 'xxscreeps/driver/pathfinder/pathfinder.js';
+import { loadSharedTerrain } from 'xxscreeps/driver/pathfinder/terrain.js';
 import { bootstrapSandbox } from 'xxscreeps/driver/sandbox/index.js';
 import { consumeSet, consumeSetMembers } from 'xxscreeps/engine/db/async.js';
 import { Database, Shard } from 'xxscreeps/engine/db/index.js';
@@ -45,7 +45,7 @@ const { migrationTimeout } = config.runner;
 
 // Load shared terrain data
 const world = await shard.loadWorld();
-loadTerrain(world); // pathfinder
+loadSharedTerrain(world); // pathfinder
 
 // Shared worker context
 await using runner = await acquireRunnerContext(shard);
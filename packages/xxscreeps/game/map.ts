@@ -4,6 +4,7 @@ import type { Room } from './room/index.js';
 import type { TypeOf } from 'xxscreeps/schema/index.js';
 import type { Adapter } from 'xxscreeps/utility/astar.js';
 import type { RemoveBrand } from 'xxscreeps/utility/brand.js';
+import { findRoute as findNativeRoute } from 'xxscreeps/driver/pathfinder/pathfinder.js';
 import { build, makeUpgrader, structForPath } from 'xxscreeps/engine/schema/index.js';
 import { primitiveComparator } from 'xxscreeps/functional/comparator.js';
 import { Fn } from 'xxscreeps/functional/fn.js';
@@ -190,8 +191,25 @@ export class GameMap {
 			return C.ERR_NO_PATH;
 		}
 
-		// Set up algorithm adapter
+		// Without a `routeCallback` every room costs the same, so the native search can be used
 		const origin = parseRoomName(fromName);
+		const { routeCallback } = opts;
+		if (!routeCallback) {
+			const route = findNativeRoute(fromName, toName);
+			if (route) {
+				let prev = origin;
+				return route.map(room => {
+					const next = parseRoomName(room);
+					const exit = getDirection(next.rx - prev.rx, next.ry - prev.ry) as ExitType;
+					prev = next;
+					return { exit, room };
+				});
+			} else {
+				return C.ERR_NO_PATH;
+			}
+		}
+
+		// Set up algorithm adapter
 		const destination = parseRoomName(toName);
 		const maxDistance = 30;
 		const offsetX = origin.rx + maxDistance;
@@ -219,15 +237,12 @@ export class GameMap {
 		};
 
 		// Execute search
-		const { routeCallback } = opts;
 		const route = astar(
 			maxDistance ** 2,
 			adapter,
 			[ origin ],
 			pos => Math.abs(destination.rx - pos.rx) + Math.abs(destination.ry - pos.ry),
-			routeCallback
-				? (to, from) => routeCallback(makeRoomName(to.rx, to.ry), makeRoomName(from.rx, from.ry)) :
-				() => 1,
+			(to, from) => routeCallback(makeRoomName(to.rx, to.ry), makeRoomName(from.rx, from.ry)),
 			// describeExits is typed `null as never` for player-facing ergonomics but
 			// can genuinely return null at runtime; `Object.values(null)` would throw.
 			pos => Fn.map(Object.values(this.describeExits(makeRoomName(pos.rx, pos.ry)) ?? {}), parseRoomName));
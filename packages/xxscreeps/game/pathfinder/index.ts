@@ -1,6 +1,6 @@
 import type { RoomPosition } from 'xxscreeps/game/position.js';
 
-import { search } from 'xxscreeps/driver/pathfinder/pathfinder.js';
+import { distanceField, search, searchMany } from 'xxscreeps/driver/pathfinder/pathfinder.js';
 import { Game, me } from 'xxscreeps/game/index.js';
 import { registerGlobal } from 'xxscreeps/game/symbols.js';
 import { getOrSet } from 'xxscreeps/utility/utility.js';
@@ -8,7 +8,7 @@ import { CostMatrix } from './cost-matrix.js';
 import { makeObstacleChecker } from './obstacle.js';
 
 export { registerObstacleChecker } from './obstacle.js';
-export { CostMatrix, search };
+export { CostMatrix, distanceField, search, searchMany };
 
 /**
  * A goal for a `PathFinder.search` operation. A goal is either a `RoomPosition` or an object with
@@ -67,7 +67,15 @@ interface CommonSearchOptions {
 	maxOps?: number | undefined;
 
 	/**
-	 * The maximum allowed rooms to search. The maximum is 64.
+	 * The maximum wall-clock time of the search in microseconds. The search stops as if it ran out of
+	 * operations once this has passed. 0 means no limit.
+	 * @public
+	 * @default 0
+	 */
+	maxTime?: number | undefined;
+
+	/**
+	 * The maximum allowed rooms to search. The maximum is 256.
 	 * @public
 	 * @default 16
 	 */
@@ -117,6 +125,46 @@ export interface SearchOptions extends CommonSearchOptions {
 	 * @default Infinity
 	 */
 	maxCost?: number;
+
+	/**
+	 * Grow a second search frontier backward from the goal and stop once the two meet. This can cut
+	 * the number of operations on long multi-room paths with a single goal. It is ignored for `flee`
+	 * searches and searches with more than one goal. Bidirectional searches always find the cheapest
+	 * path, so `heuristicWeight` is ignored.
+	 * @public
+	 * @default false
+	 */
+	bidirectional?: boolean;
+
+	/**
+	 * Plan a route over room entrances first and then only search tiles in the rooms along that
+	 * route. This makes long multi-room searches much cheaper, but the path may be slightly longer
+	 * than the best path. It is ignored for `flee` searches and searches with more than one goal.
+	 * @public
+	 * @default false
+	 */
+	hierarchical?: boolean;
+
+	/**
+	 * Tighten the search heuristic with distances to a few landmark tiles, precomputed from the world
+	 * terrain. This can cut the number of operations when walls force long detours. It is ignored for
+	 * `flee` searches, searches with more than one goal, and until the landmark table has been built
+	 * in the background, which starts with the first search that sets this option. Paths may be
+	 * suboptimal if `roomCallback` makes a natural wall walkable.
+	 * @public
+	 * @default false
+	 */
+	landmarks?: boolean;
+
+	/**
+	 * Reuse the result of an identical earlier search, made this tick or a recent one, without
+	 * searching again. The cached path is only used if `roomCallback` returns the same cost matrix
+	 * contents for every room the earlier search opened. `ops` is 0 when a cached path is used.
+	 * The cache is shared by everything running on a thread, so it's ignored in player sandboxes.
+	 * @public
+	 * @default false
+	 */
+	cache?: boolean;
 }
 
 export interface RoomSearchOptions extends CommonSearchOptions {
@@ -160,7 +208,8 @@ export interface RoomSearchOptions extends CommonSearchOptions {
 	range?: number;
 }
 
-const cachedCostMatrices = new Map<string, CostMatrix | undefined>();
+// Cost matrices built this tick, by `costMatrixKey` and then room name
+const cachedCostMatrices = new Map<string, Map<string, CostMatrix | undefined>>();
 
 export function flush() {
 	cachedCostMatrices.clear();
@@ -174,16 +223,29 @@ export function roomSearch(origin: RoomPosition, goals: RoomPosition[], options:
 		(ignoreDestructibleStructures ? 'b' : '') +
 		(ignoreRoads ? 'c' : '');
 	const baseCost = ignoreRoads ? 1 : 2;
-	const internalOptions: SearchOptions = {
+	const costMatrices = getOrSet(cachedCostMatrices, costMatrixKey, () => new Map<string, CostMatrix | undefined>());
+
+	// Matrices already built this tick are passed upfront, which saves a callback for each of those
+	// rooms. `costCallback` may change them on every call, so it still needs the callback.
+	const matrices = costCallback ? undefined : function*() {
+		for (const [ roomName, costMatrix ] of costMatrices) {
+			if (costMatrix) {
+				yield [ roomName, costMatrix ] as const;
+			}
+		}
+	}();
+	const internalOptions: SearchOptions & { matrices?: typeof matrices } = {
 		heuristicWeight: options.heuristicWeight,
 		maxOps: options.maxOps,
 		maxRooms: options.maxRooms,
+		maxTime: options.maxTime,
 		plainCost: options.plainCost ?? baseCost,
 		swampCost: options.swampCost ?? baseCost * 5,
+		matrices,
 
 		roomCallback(roomName) {
 			// Get cost matrix for this room
-			const costMatrix = getOrSet(cachedCostMatrices, `${roomName}:${costMatrixKey}`, () => {
+			const costMatrix = getOrSet(costMatrices, roomName, () => {
 				// Return early if there's no access to this room
 				const room = Game.rooms[roomName];
 				if (!room) {
@@ -276,6 +338,30 @@ const PathFinder = {
 	 * @see https://docs.screeps.com/api/#PathFinder.search
 	 */
 	search,
+
+	/**
+	 * Run several searches in one call. `roomCallback` is shared by every query and invoked at most
+	 * once per room, so rooms opened by an earlier query are reused by later ones.
+	 * @param queries An array of `{ origin, goal, options }` objects, with the same meaning as the
+	 * arguments to `search`. `options.roomCallback` is ignored.
+	 * @param roomCallback Room callback for the whole batch, see `SearchOptions`.
+	 * @returns An array of results in the same order as `queries`.
+	 * @public
+	 */
+	searchMany,
+
+	/**
+	 * Find the cost of the cheapest path from every reachable tile to the nearest goal, and the
+	 * direction of the first step along that path. Many creeps heading to the same place can share
+	 * one field instead of each running a search.
+	 * @param goal A goal or an array of goals, in the same format as `search`.
+	 * @param options A {@link SearchOptions} object. `roomCallback`, `plainCost`, `swampCost`,
+	 * `maxRooms`, `maxOps` and `maxCost` are used.
+	 * @returns A `Map` of room name to `{ distances, directions }`, each indexed by `y * 50 + x`.
+	 * Unreached tiles have a distance of `0xffff` and a direction of `0`.
+	 * @public
+	 */
+	distanceField,
 };
 registerGlobal('PathFinder', PathFinder);
 declare module 'xxscreeps/game/runtime.js' {
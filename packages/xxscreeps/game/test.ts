@@ -1,6 +1,14 @@
+import type { Direction } from './direction.js';
 import * as assert from 'node:assert';
-import { search } from 'xxscreeps/driver/pathfinder/pathfinder.js';
+import * as fs from 'node:fs';
+import * as os from 'node:os';
+import * as path from 'node:path';
+import { configureParallelSearch, createMatrixStore, createPlanner, distanceField, findRoute, loadTerrainFile, search, searchMany, searchPacked, searchParallel, searchStats, startSearch, stats } from 'xxscreeps/driver/pathfinder/pathfinder.js';
+import { testWorld } from 'xxscreeps/test/import.js';
 import { describe, test } from 'xxscreeps/test/index.js';
+import { TERRAIN_MASK_WALL } from './constants/index.js';
+import { getOffsetsFromDirection } from './direction.js';
+import { CostMatrix } from './pathfinder/cost-matrix.js';
 import { RoomPosition } from './position.js';
 
 interface PositionAssertion {
@@ -75,5 +83,365 @@ describe('game', () => {
 				path: [],
 			});
 		});
+
+		test('bidirectional matches forward search', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const options = { heuristicWeight: 1, maxRooms: 8 };
+			const forward = search(origin, [ destination ], options);
+			const bidirectional = search(origin, [ destination ], { ...options, bidirectional: true });
+			assert.ok(!forward.incomplete);
+			assert.ok(!bidirectional.incomplete);
+			assert.strictEqual(bidirectional.cost, forward.cost);
+			assert.ok(bidirectional.path.at(-1)!.isEqualTo(destination));
+
+			// The default weight would make the meeting rule stop early
+			const weighted = search(origin, [ destination ], { maxRooms: 8 });
+			const weightedBidirectional = search(origin, [ destination ], { maxRooms: 8, bidirectional: true });
+			assert.ok(!weightedBidirectional.incomplete);
+			assert.strictEqual(weightedBidirectional.cost, forward.cost);
+			assert.ok(weightedBidirectional.cost <= weighted.cost);
+		});
+
+		test('landmark search matches forward search', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const options = { heuristicWeight: 1, maxRooms: 8 };
+			const forward = search(origin, [ destination ], options);
+			const landmarks = search(origin, [ destination ], { ...options, landmarks: true });
+			assert.ok(!landmarks.incomplete);
+			assert.strictEqual(landmarks.cost, forward.cost);
+			assert.ok(landmarks.path.at(-1)!.isEqualTo(destination));
+		});
+
+		test('multi-goal search matches closest goal', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const goals = Array.from({ length: 20 }, (_, ii) => new RoomPosition(5 + ii * 2, 10 + ii % 3, 'W1N1'));
+			const options = { heuristicWeight: 1 };
+			const reachable = goals.map(pos => search(origin, [ { pos, range: 1 } ], options)).filter(result => !result.incomplete);
+			const closest = Math.min(...reachable.map(result => result.cost));
+			const many = search(origin, goals.map(pos => ({ pos, range: 1 })), options);
+			assert.ok(!many.incomplete);
+			assert.strictEqual(many.cost, closest);
+			const flee = search(origin, goals.map(pos => ({ pos, range: 5 })), { flee: true });
+			assert.ok(!flee.incomplete);
+			assert.ok(goals.every(goal => flee.path.at(-1)!.getRangeTo(goal) >= 5));
+		});
+
+		test('packed search matches search', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const options = { maxRooms: 8 };
+			const expected = search(origin, [ destination ], options);
+			const packed = searchPacked(origin, [ destination ], { ...options, directions: true });
+			assert.strictEqual(packed.cost, expected.cost);
+			assert.strictEqual(packed.path.length, expected.path.length);
+			let previous = origin;
+			for (const [ ii, pos ] of expected.path.entries()) {
+				const packedPos = packed.path[ii]!;
+				assert.strictEqual(packedPos & 0xffff, pos['#rx'] * 50 + pos.x);
+				assert.strictEqual(packedPos >>> 16, pos['#ry'] * 50 + pos.y);
+				if (pos.roomName === previous.roomName) {
+					assert.strictEqual(packed.directions![ii], previous.getDirectionTo(pos));
+				}
+				previous = pos;
+			}
+			// A larger search from the room callback grows the scratch buffers mid-search
+			let nested = false;
+			const roomCallback = () => {
+				if (!nested) {
+					nested = true;
+					searchPacked(origin, [ destination ], { maxRooms: 64, directions: true });
+				}
+				return undefined;
+			};
+			const outer = searchPacked(origin, [ destination ], { ...options, roomCallback, directions: true });
+			assert.deepStrictEqual(outer.path, packed.path);
+			assert.deepStrictEqual(outer.directions, packed.directions);
+		});
+
+		test('preloaded matrices skip room callback', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const matrix = new CostMatrix();
+			matrix.set(24, 24, 0xff);
+			const expected = search(origin, destination, { roomCallback: () => matrix, maxRooms: 8 });
+			const rooms: string[] = [];
+			const roomCallback = (roomName: string) => {
+				rooms.push(roomName);
+				return matrix;
+			};
+			const preloaded = search(origin, destination, { roomCallback, matrices: [ [ 'W1N1', matrix ], [ 'W2N2', matrix ] ], maxRooms: 8 });
+			assert.strictEqual(preloaded.cost, expected.cost);
+			assert.ok(!rooms.includes('W1N1'));
+			assert.ok(!rooms.includes('W2N2'));
+		});
+
+		test('matrix store', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(25, 20, 'W1N1');
+			const store = createMatrixStore();
+			const matrix = new CostMatrix();
+			store.set('structures', [ [ 'W1N1', matrix ] ]);
+			const version = store.version('structures', 'W1N1');
+			assert.ok(version !== undefined);
+			store.set('structures', [ [ 'W1N1', matrix ] ]);
+			assert.strictEqual(store.version('structures', 'W1N1'), version);
+
+			// Block an off-diagonal tile; its transpose must stay open
+			const blocked = new RoomPosition(30, 20, 'W1N1');
+			const transposed = new RoomPosition(20, 30, 'W1N1');
+			store.patch('structures', [ [ blocked, 0xff ] ]);
+			assert.notStrictEqual(store.version('structures', 'W1N1'), version);
+			const roomCallback = () => assert.fail('room callback was invoked');
+			const options = { roomCallback, matrixStore: store, matrixVariant: 'structures', maxRooms: 1 };
+			assert.ok(search(origin, blocked, options).incomplete);
+			assert.ok(!search(origin, transposed, options).incomplete);
+			const stored = search(origin, destination, options);
+			assert.ok(!stored.incomplete);
+			assert.strictEqual(store.version('other', 'W1N1'), undefined);
+			store.free();
+		});
+
+		test('terrain file', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const expected = search(origin, destination, { maxRooms: 8 });
+			const file = path.join(os.tmpdir(), `xxscreeps-terrain-${process.pid}.bin`);
+			try {
+				loadTerrainFile(testWorld, file);
+				assert.ok(fs.existsSync(file));
+				const mapped = search(origin, destination, { maxRooms: 8 });
+				assert.strictEqual(mapped.cost, expected.cost);
+				assert.deepStrictEqual(mapped.path, expected.path);
+			} finally {
+				fs.rmSync(file, { force: true });
+			}
+		});
+
+		test('goals cut off by terrain are rejected', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const terrain = testWorld.map.getRoomTerrain('W1N1');
+			const wall = [ ...Array(2500).keys() ].find(ii => terrain.get(ii % 50, Math.floor(ii / 50)) === TERRAIN_MASK_WALL)!;
+			const destination = new RoomPosition(wall % 50, Math.floor(wall / 50), 'W1N1');
+			const rejected = search(origin, { pos: destination, range: 0 }, { maxRooms: 1 });
+			assert.ok(rejected.incomplete);
+			assert.strictEqual(rejected.ops, 0);
+			// A room callback may change terrain, so the search runs
+			const searched = search(origin, { pos: destination, range: 0 }, { maxRooms: 1, roomCallback: () => new CostMatrix() });
+			assert.ok(searched.incomplete);
+			assert.notStrictEqual(searched.ops, 0);
+		});
+
+		test('maxTime stops the search', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const expected = search(origin, destination, { maxRooms: 8 });
+			// Polling more often doesn't change the result
+			const polled = search(origin, destination, { maxRooms: 8, checkInterval: 1 });
+			assert.strictEqual(polled.cost, expected.cost);
+			assert.strictEqual(polled.ops, expected.ops);
+			const timed = search(origin, destination, { maxRooms: 8, maxTime: 1, checkInterval: 1 });
+			assert.ok(timed.incomplete);
+			assert.ok(timed.ops < expected.ops);
+		});
+
+		test('search stats', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const before = stats();
+			const result = search(origin, destination, { maxRooms: 8 });
+			const last = searchStats();
+			assert.ok(last.popped - last.stale >= result.ops);
+			assert.ok(last.pushed >= last.popped);
+			assert.ok(last.roomsOpened > 1);
+			assert.ok(last.totalTime >= last.expandTime);
+			const after = stats();
+			assert.strictEqual(after.searches, before.searches + 1);
+			assert.strictEqual(after.opsHistogram.reduce((sum, count) => sum + count, 0), after.searches);
+		});
+
+		test('hierarchical search', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const hierarchical = search(origin, [ destination ], { maxRooms: 8, hierarchical: true });
+			assert.ok(!hierarchical.incomplete);
+			assert.ok(hierarchical.path.at(-1)!.isEqualTo(destination));
+
+			// Blocking the planned corridor repeats the search over all rooms within the same budget
+			const corridor = hierarchical.path.map(pos => pos.roomName).find(roomName => roomName !== 'W1N1' && roomName !== 'W2N2');
+			assert.ok(corridor !== undefined);
+			const maxOps = 4000;
+			const roomCallback = (roomName: string) => (roomName === corridor ? false : undefined);
+			const fallback = search(origin, [ destination ], { maxOps, maxRooms: 8, hierarchical: true, roomCallback });
+			assert.ok(!fallback.incomplete);
+			assert.ok(fallback.path.at(-1)!.isEqualTo(destination));
+			assert.ok(!fallback.path.some(pos => pos.roomName === corridor));
+			assert.ok(fallback.ops <= maxOps);
+		});
+
+		test('cached search', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const matrix = new CostMatrix();
+			const roomCallback = () => matrix;
+			const first = search(origin, destination, { roomCallback, cacheTime: 1 });
+			const second = search(origin, destination, { roomCallback, cacheTime: 1 });
+			assert.notStrictEqual(first.ops, 0);
+			assert.strictEqual(second.ops, 0);
+			assert.strictEqual(second.cost, first.cost);
+			assert.strictEqual(second.path.length, first.path.length);
+			// Changed matrix contents invalidate the entry
+			matrix.set(24, 24, 0xff);
+			const third = search(origin, destination, { roomCallback, cacheTime: 2 });
+			assert.notStrictEqual(third.ops, 0);
+
+			// Stored matrices are checked by version, without invoking the room callback
+			const store = createMatrixStore();
+			store.set('structures', [ [ 'W1N1', matrix ] ]);
+			const local = new RoomPosition(40, 40, 'W1N1');
+			const options = {
+				roomCallback: () => assert.fail('room callback was invoked'),
+				matrixStore: store,
+				matrixVariant: 'structures',
+				maxRooms: 1,
+				cacheTime: 3,
+			};
+			assert.notStrictEqual(search(origin, local, options).ops, 0);
+			assert.strictEqual(search(origin, local, options).ops, 0);
+			store.patch('structures', [ [ new RoomPosition(30, 30, 'W1N1'), 0xff ] ]);
+			assert.notStrictEqual(search(origin, local, options).ops, 0);
+			store.free();
+		});
+
+		test('searchMany matches search', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const goals = [ new RoomPosition(20, 20, 'W2N2'), new RoomPosition(10, 40, 'W1N1') ];
+			// Rooms stay open for the whole batch, so each room is resolved once
+			const calls = new Map<string, number>();
+			const before = stats();
+			const results = searchMany(goals.map(goal => ({ origin, goal })), roomName => {
+				calls.set(roomName, (calls.get(roomName) ?? 0) + 1);
+			});
+			const after = stats();
+			assert.strictEqual(results.length, 2);
+			assert.ok(calls.size > 1);
+			assert.ok([ ...calls.values() ].every(count => count === 1));
+			assert.strictEqual(after.roomsOpened - before.roomsOpened, calls.size);
+			for (const [ ii, goal ] of goals.entries()) {
+				const result = search(origin, goal);
+				assert.strictEqual(results[ii]!.cost, result.cost);
+				assert.strictEqual(results[ii]!.path.length, result.path.length);
+			}
+		});
+
+		test('searchParallel matches search', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const goals = [ new RoomPosition(20, 20, 'W2N2'), new RoomPosition(10, 40, 'W1N1'), new RoomPosition(40, 10, 'W1N1') ];
+			// Batches run on the calling thread alone until workers are configured
+			for (const workers of [ 0, 2 ]) {
+				configureParallelSearch(workers);
+				const results = searchParallel(goals.map(goal => ({ origin, goal })));
+				assert.strictEqual(results.length, 3);
+				for (const [ ii, goal ] of goals.entries()) {
+					const result = search(origin, goal);
+					assert.strictEqual(results[ii]!.cost, result.cost);
+					assert.strictEqual(results[ii]!.path.length, result.path.length);
+				}
+			}
+			configureParallelSearch(0);
+			const blocked = searchParallel([ { origin, goal: goals[0]! } ], [ [ 'W2N2', false ] ]);
+			assert.ok(blocked[0]!.incomplete);
+		});
+
+		test('empty goal lists', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			for (const result of [ ...searchMany([ { origin, goal: [] } ]), ...searchParallel([ { origin, goal: [] } ]) ]) {
+				assert.strictEqual(result.path.length, 0);
+				assert.ok(!result.incomplete);
+			}
+			const resumable = startSearch(origin, []);
+			try {
+				const progress = resumable.resume(10);
+				assert.ok(progress.done);
+				assert.ok(!progress.incomplete);
+			} finally {
+				resumable.free();
+			}
+			assert.strictEqual(distanceField([]).size, 0);
+		});
+
+		test('resumed search matches search', () => {
+			const origin = new RoomPosition(25, 25, 'W1N1');
+			const destination = new RoomPosition(20, 20, 'W2N2');
+			const options = { maxRooms: 8 };
+			const expected = search(origin, destination, options);
+			const resumable = startSearch(origin, destination, options);
+			try {
+				let progress = resumable.resume(10);
+				assert.ok(!progress.done);
+				assert.strictEqual(progress.ops, 10);
+				while (!progress.done) {
+					progress = resumable.resume(10);
+				}
+				assert.strictEqual(progress.ops, expected.ops);
+				assert.strictEqual(progress.cost, expected.cost);
+				assert.strictEqual(progress.path.length, expected.path.length);
+			} finally {
+				resumable.free();
+			}
+		});
+
+		test('planner repairs after changes', () => {
+			const origin = new RoomPosition(10, 25, 'W1N1');
+			const destination = new RoomPosition(40, 25, 'W1N1');
+			const options = { heuristicWeight: 1, maxRooms: 1 };
+			const planner = createPlanner(origin, destination, options);
+			try {
+				const first = planner.update(origin);
+				assert.ok(!first.incomplete);
+				assert.strictEqual(first.cost, search(origin, destination, options).cost);
+				// Block a tile on the path and compare with a fresh search
+				const blocked = first.path[10]!;
+				const second = planner.update(origin, [ [ blocked, 0xff ] ]);
+				const matrix = new CostMatrix();
+				matrix.set(blocked.x, blocked.y, 0xff);
+				const fresh = search(origin, destination, { ...options, roomCallback: () => matrix });
+				assert.ok(!second.incomplete);
+				assert.strictEqual(second.cost, fresh.cost);
+				assert.ok(second.ops < first.ops);
+				assert.ok(!second.path.some(pos => pos.isEqualTo(blocked)));
+			} finally {
+				planner.free();
+			}
+		});
+
+		test('distanceField matches search cost', () => {
+			const goal = new RoomPosition(25, 25, 'W1N1');
+			const origin = new RoomPosition(20, 20, 'W1N1');
+			const field = distanceField(goal, { maxRooms: 1 }).get('W1N1')!;
+			const result = search(origin, goal, { heuristicWeight: 1, maxRooms: 1 });
+			assert.strictEqual(field.distances[25 * 50 + 25], 0);
+			assert.strictEqual(field.distances[20 * 50 + 20], result.cost);
+			// Following the directions from the origin reaches the goal, with the cost falling each step
+			let xx = origin.x;
+			let yy = origin.y;
+			for (let steps = 0; xx !== goal.x || yy !== goal.y; ++steps) {
+				assert.ok(steps < 50 * 50);
+				const direction = field.directions[yy * 50 + xx]! as Direction;
+				assert.notStrictEqual(direction, 0);
+				const { dx, dy } = getOffsetsFromDirection(direction);
+				assert.ok(field.distances[(yy + dy) * 50 + xx + dx]! < field.distances[yy * 50 + xx]!);
+				xx += dx;
+				yy += dy;
+			}
+		});
+
+		test('findRoute', () => {
+			const route = findRoute('W1N1', 'W2N2');
+			assert.strictEqual(route?.length, 2);
+			assert.strictEqual(route.at(-1), 'W2N2');
+			assert.deepStrictEqual(findRoute('W1N1', 'W1N1'), []);
+		});
 	});
 });
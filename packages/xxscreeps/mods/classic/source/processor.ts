@@ -1,5 +1,5 @@
 import type { RoomPosition } from 'xxscreeps/game/position.js';
-import { search } from 'xxscreeps/driver/pathfinder/pathfinder.js';
+import { search, searchParallel } from 'xxscreeps/driver/pathfinder/pathfinder.js';
 import { registerObjectTickProcessor } from 'xxscreeps/engine/processor/index.js';
 import { mappedInvertedNumericComparator, mappedNumericComparator } from 'xxscreeps/functional/comparator.js';
 import { Fn } from 'xxscreeps/functional/fn.js';
@@ -102,21 +102,28 @@ registerNPC(kSourceKeeperUserId, Game => {
 				const lairs = lookForStructures(creep.room, C.STRUCTURE_KEEPER_LAIR);
 				const home = lairs.find(lair => creep.name === `Keeper${lair.id}`)!;
 				const terrain = creep.room.getTerrain();
-				const costTo = (origin: RoomPosition, goal: RoomPosition) => {
-					// Search specifically to walkable nodes to handle the case where a source is neighboring
-					// a keeper lair, but separated by a wall.
-					const goals = Fn.reject(iterateNeighbors(goal), pos => terrain.get(pos.x, pos.y) === C.TERRAIN_MASK_WALL);
-					const result = search(origin, [ ...goals ], { maxCost: 25 });
-					return result.incomplete ? Infinity : result.cost;
-				};
+				// Search specifically to walkable nodes to handle the case where a source is neighboring a
+				// keeper lair, but separated by a wall.
+				const goalsNear = (goal: RoomPosition) =>
+					[ ...Fn.reject(iterateNeighbors(goal), pos => terrain.get(pos.x, pos.y) === C.TERRAIN_MASK_WALL) ];
+				const costOf = (result: { cost: number; incomplete: boolean }) => result.incomplete ? Infinity : result.cost;
+				const costTo = (origin: RoomPosition, goal: RoomPosition) =>
+					costOf(search(origin, goalsNear(goal), { maxCost: 25 }));
 
 				// Search farthest resources first, to ensure that we get shortest total path length between
-				// all lair :: source pairs
-				const resourceInfo = resources.map(resource => ({
-					cost: costTo(home.pos, resource.pos),
+				// all lair :: source pairs. The searches from the lair are independent, so they run as one
+				// batch.
+				const homeResults = searchParallel(resources.map(resource => ({
+					origin: home.pos,
+					goal: goalsNear(resource.pos),
+					options: { maxCost: 25 },
+				})));
+				const resourceInfo = resources.map((resource, ii) => ({
+					cost: costOf(homeResults[ii]!),
 					resource,
 				}));
-				resources.sort(mappedInvertedNumericComparator(resource => costTo(home.pos, resource.pos)));
+				const homeCosts = new Map(resourceInfo.map(info => [ info.resource, info.cost ]));
+				resources.sort(mappedInvertedNumericComparator(resource => homeCosts.get(resource)!));
 				for (const { resource } of Fn.reject(resourceInfo, info => info.cost === Infinity)) {
 					// Find distance to each lair from this resource
 					const localLairs = lairs.filter(lair => resource.pos.inRangeTo(lair, 5)).map(lair => ({